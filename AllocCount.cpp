@@ -0,0 +1,46 @@
+#include <cstdlib>
+#include <new>
+#include "AllocCount.h"
+
+#ifdef ROBOTWARZ_COUNT_ALLOCS
+// Every other form of new and delete in libstdc++ ends up in one of these.
+static thread_local uint64_t allocations = 0;
+
+uint64_t allocation_count(){
+    return allocations;
+}
+
+void* operator new(std::size_t size){
+    allocations++;
+    if (void* memory = std::malloc(size ? size : 1)){
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t align){
+    allocations++;
+    std::size_t alignment = static_cast<std::size_t>(align);
+    size = size ? size : 1;
+    if (void* memory = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment)){
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept{
+    std::free(memory);
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+
+// 'make alloc_check' builds RobotWarz_alloc with ROBOTWARZ_COUNT_ALLOCS defined, which
+// replaces the global operator new with one that counts calls on each thread. The
+// arena uses it to check that rounds past the first allocate nothing on its side.
+// Other builds compile the counting away.
+#ifdef ROBOTWARZ_COUNT_ALLOCS
+// operator new calls made on this thread so far.
+uint64_t allocation_count();
+#else
+inline uint64_t allocation_count(){
+    return 0;
+}
+#endif
@@ -5,15 +5,68 @@
 #include <cstdlib>
 #include <ctime>
 #include <iomanip>
+#include <algorithm>
+#include <bit>
 #include <dlfcn.h>
 #include <filesystem>
 #include <unistd.h>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdio>
 #include "RobotBase.h"
 #include "Arena.h"
+#include "ShotStencil.h"
+#include "AllocCount.h"
+#include "RobotRand.h"
+#ifdef ROBOTWARZ_STATIC_BUNDLE
+#include "RobotRegistry.h"
+#endif
 
 namespace fs = std::filesystem;
 
-Arena::Arena(){};
+Arena::Arena(){
+    set_seed(0);
+};
+
+void Arena::set_output(std::ostream& stream){
+    out = &stream;
+}
+
+void Arena::set_watch_live(bool live){
+    watch_live = live;
+}
+
+void Arena::set_headless(bool on){
+    headless = on;
+}
+
+void Arena::set_log_sink(LogSink* sink){
+    log_sink = sink;
+}
+
+void Arena::set_replay(ReplayWriter* writer){
+    replay = writer;
+}
+
+void Arena::set_live_view(bool on){
+    use_live_view = on;
+}
+
+bool Arena::is_watch_live() const{
+    return watch_live;
+}
+
+// Each kind of randomness gets its own stream, so e.g. a robot taking a different
+// number of shots doesn't change where the next game's obstacles end up.
+void Arena::set_seed(uint64_t new_seed){
+    seed = new_seed;
+    map_rng.reseed(seed, 1);
+    spawn_rng.reseed(seed, 2);
+    damage_rng.reseed(seed, 3);
+}
 
 Arena::~Arena(){};
 
@@ -22,7 +75,7 @@ void Arena::load_config(std::string fileName){
 
     inFile.open(fileName);
     if (!inFile){
-        std::cout << "File could not be read.";
+        *out << "File could not be read.";
     }
 
     std::string key;
@@ -46,23 +99,64 @@ void Arena::load_config(std::string fileName){
             watch_live = (value == "true");
         } else if (key == "max_robots") {
             inFile >> maxRobots;
+        } else if (key == "compile_jobs") {
+            inFile >> compileJobs;
+        } else if (key == "radar_cache_mb") {
+            inFile >> radarCacheMB;
+        } else if (key == "watch_fps") {
+            inFile >> watchFps;
+        } else if (key == "watch_round_ms") {
+            inFile >> watchRoundMs;
+        } else if (key == "stalemate_rounds") {
+            inFile >> stalemateRounds;
+        } else if (key == "end_on_repeat") {
+            std::string value;
+            inFile >> value;
+            endOnRepeat = (value == "true");
         }
     }
 
     inFile.close();
+    size_grid();
+}
 
-    // Initialize the grid with the loaded dimensions
-    grid.resize(arenaHeight);
-    for (int i = 0; i < arenaHeight; i++) {
-        grid[i].resize(arenaWidth, '.');
+// Initializes the grid for arenaHeight by arenaWidth. Everything is stored with a
+// one cell border of empty padding so neighbour lookups never leave the buffer.
+void Arena::size_grid(){
+    gridStride = arenaWidth + 2;
+    bitStride = (gridStride + 63) / 64;
+    size_t cells = static_cast<size_t>(arenaHeight + 2) * gridStride;
+    size_t words = static_cast<size_t>(arenaHeight + 2) * bitStride;
+
+    terrain.assign(cells, '.');
+    occupancy.assign(cells, -1);
+    terrain_bits.assign(words, 0);
+    robot_bits.assign(words, 0);
+    terrain_hash = 0;
+
+    int diagonal_length = (arenaHeight + arenaWidth - 2) / 2 + 1;
+    radar_lines[line_rows].resize(arenaHeight, arenaWidth);
+    radar_lines[line_cols].resize(arenaWidth, arenaHeight);
+    radar_lines[line_diagonals].resize(arenaHeight + arenaWidth - 1, diagonal_length);
+    radar_lines[line_anti_diagonals].resize(arenaHeight + arenaWidth - 1, diagonal_length);
+    for (int family = line_rows; family <= line_anti_diagonals; family++){
+        robot_lines[family].resize(radar_lines[family].lines, family == line_cols ? arenaHeight :
+                                   family == line_rows ? arenaWidth : diagonal_length);
     }
+    clear_radar_cache();
+
+    // Room for the biggest scan there can be: three lanes across the arena with terrain
+    // and a robot in every cell. Turns then never grow the buffers.
+    size_t longest_scan = 3 * static_cast<size_t>(std::max(arenaHeight, arenaWidth)) + 8;
+    radar_results.reserve(2 * longest_scan);
+    radar_overlay.reserve(longest_scan);
 }
 
 bool Arena::cellEmpty(int& row, int& col){
     if (row < 0 || row >= arenaHeight || col < 0 || col >= arenaWidth){
         return false;
     }
-    if (grid[row][col] != '.'){
+    if (terrain_at(row, col) != '.'){
         return false;
     }
     if (findRobotAt(row, col) != nullptr){
@@ -73,73 +167,43 @@ bool Arena::cellEmpty(int& row, int& col){
 
 void Arena::place_obstacles(){
     for (int i = 0; i < mounds; i++){
-        int row = rand() % arenaHeight;
-        int col = rand() % arenaWidth;
+        int row = map_rng.below(arenaHeight);
+        int col = map_rng.below(arenaWidth);
 
         while (!cellEmpty(row, col)){
-            row = rand() % arenaHeight;
-            col = rand() % arenaWidth;
+            row = map_rng.below(arenaHeight);
+            col = map_rng.below(arenaWidth);
         }
-        grid[row][col] = 'M';
+        set_terrain(row, col, 'M');
     }
 
     for (int i = 0; i < pits; i++){
-        int row = rand() % arenaHeight;
-        int col = rand() % arenaWidth;
+        int row = map_rng.below(arenaHeight);
+        int col = map_rng.below(arenaWidth);
 
         while (!cellEmpty(row, col)){
-            row = rand() % arenaHeight;
-            col = rand() % arenaWidth;
+            row = map_rng.below(arenaHeight);
+            col = map_rng.below(arenaWidth);
         }
-        grid[row][col] = 'P';
+        set_terrain(row, col, 'P');
     }
 
     for (int i = 0; i < flamethrowers; i++){
-        int row = rand() % arenaHeight;
-        int col = rand() % arenaWidth;
+        int row = map_rng.below(arenaHeight);
+        int col = map_rng.below(arenaWidth);
 
         while (!cellEmpty(row, col)){
-            row = rand() % arenaHeight;
-            col = rand() % arenaWidth;
+            row = map_rng.below(arenaHeight);
+            col = map_rng.below(arenaWidth);
         }
-        grid[row][col] = 'F';
+        set_terrain(row, col, 'F');
     }
+
 }
 
 void Arena::display() {
-    // Print column headers
-    std::cout << "   ";
-    for (int column = 0; column < arenaWidth; column++) {
-        std::cout << std::setw(3) << std::right << column; 
-    }
-    std::cout << "\n";
-    std::cout << std::endl;
-
-    // Print each row
-    for (int row = 0; row < arenaHeight; row++) {
-        std::cout << std::setw(2) << std::right << row;
-        std::cout << "  ";
-
-        for (int col = 0; col < arenaWidth; col++) {
-            RobotBase* robot = findRobotAt(row, col);
-            
-            if (robot != nullptr) {
-                // Robot found at this cell
-                if (robot->get_health() > 0) {
-                    // Living robot: print "R" + character
-                    std::cout << " R" << robot->m_character;
-                } else {
-                    // Dead robot: print "X" + character
-                    std::cout << " X" << robot->m_character;
-                }
-            } else {
-                // No robot, print terrain
-                std::cout << std::setw(3) << std::right << grid[row][col];
-            }
-        }
-
-        std::cout << "\n";
-    }
+    window_cells(0, 0, arenaHeight, arenaWidth, display_cells);
+    write_board(*out, arenaHeight, arenaWidth, display_cells.data());
 }
 
 std::vector<std::string> Arena::find_robot_files(){
@@ -153,6 +217,8 @@ std::vector<std::string> Arena::find_robot_files(){
             }
         }
     }
+    // Directory order isn't defined; sorting keeps robot indexes and characters stable.
+    std::sort(filenames.begin(), filenames.end());
     return filenames;
 }
 
@@ -171,231 +237,978 @@ bool Arena::matches_robot_pattern(std::string filename){
     }
 }
 
-std::string Arena::compileRobot(const std::string& fileName){
+// FNV-1a over a file's bytes, continuing from 'hash'. Missing files hash as empty.
+static uint64_t hash_file(const std::string& path, uint64_t hash){
+    std::ifstream file(path, std::ios::binary);
+    char buffer[4096];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0){
+        for (std::streamsize i = 0; i < file.gcount(); i++){
+            hash = (hash ^ static_cast<unsigned char>(buffer[i])) * 0x100000001b3ULL;
+        }
+    }
+    return hash;
+}
+
+static uint64_t hash_string(const std::string& text, uint64_t hash){
+    for (unsigned char c : text){
+        hash = (hash ^ c) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// A robot library only needs rebuilding when its source, the headers and object it
+// is built against, or the compile command change. The hash of all of those is kept
+// next to the library in lib<Name>.so.hash.
+// This runs on the compile worker threads, so it only writes to the returned build.
+RobotBuild Arena::compileRobot(const std::string& fileName){
+    RobotBuild build;
+    build.fileName = fileName;
+
     std::string robotName = fileName.substr(6, fileName.size() - 10);
 
     std::string sharedLib = std::string("lib") + robotName + ".so";
+    build.sharedLib = sharedLib;
+
+    // The robot's rand() and srand() are pointed at the arena's; see RobotRand.h.
+    const std::string compileCMD = std::string("g++ -shared -fPIC -DROBOTWARZ_ROBOT_CODE -include RobotRand.h -o ") + sharedLib + " " +
+                                   fileName + " RobotBase.o -I. -std=c++20";
 
-    const std::string compileCMD = std::string("g++ -shared -fPIC -o ") + sharedLib + " " + fileName + " RobotBase.o -I. -std=c++20";
+    uint64_t hash = hash_string(compileCMD, 0xcbf29ce484222325ULL);
+    for (const char* input : {"RobotBase.h", "RadarObj.h", "RobotRand.h", "RobotBase.o"}){
+        hash = hash_file(input, hash);
+    }
+    hash = hash_file(fileName, hash);
+
+    std::ostringstream hash_text;
+    hash_text << std::hex << std::setw(16) << std::setfill('0') << hash;
+    std::string stampFile = sharedLib + ".hash";
+
+    std::string stamp;
+    std::ifstream stampIn(stampFile);
+    stampIn >> stamp;
+    if (stamp == hash_text.str() && fs::exists(sharedLib)){
+        build.log = fileName + " unchanged, using " + sharedLib + " (cache hit)\n";
+        build.ok = true;
+        return build;
+    }
 
-    std::cout << "Compiling " + fileName + "...\n";
+    build.log = "Compiling " + fileName + "...\n";
 
-    int result = system(compileCMD.c_str());
+    auto start = std::chrono::steady_clock::now();
+    FILE* compiler = popen((compileCMD + " 2>&1").c_str(), "r");
+    if (compiler == nullptr){
+        build.log += "Error\n";
+        return build;
+    }
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), compiler)) > 0){
+        build.log.append(buffer, count);
+    }
+    int result = pclose(compiler);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
     if (result != 0){
-        std::cout << "Error";
-        return "";
+        build.log += "Error\n";
+        fs::remove(stampFile);
+        return build;
     }
+    std::ostringstream timing;
+    timing << std::fixed << std::setprecision(2) << seconds;
+    build.log += "Compiled " + sharedLib + " (cache miss, " + timing.str() + "s)\n";
 
-    return sharedLib;
+    std::ofstream stampOut(stampFile);
+    stampOut << hash_text.str() << "\n";
+
+    build.ok = true;
+    return build;
 }
 
-RobotBase* Arena::loadRobot(const std::string& sharedLib){
+RobotFactory Arena::loadFactory(const std::string& sharedLib){
     std::string fullPath = "./" + sharedLib;
     void* handle = dlopen(fullPath.c_str(), RTLD_LAZY);
     if (!handle){
-        std::cout << "Error loading library: " << dlerror() << std::endl;
+        *out << "Error loading library: " << dlerror() << std::endl;
         return nullptr;
     }
 
     void* sym = dlsym(handle, "create_robot");
 
     if (sym == nullptr){
-        std::cout << dlerror() <<std::endl;
-        dlclose(handle);
-        return nullptr;
-    }
-    typedef RobotBase* (*CreateRobotFunc)();
-    CreateRobotFunc createRobot = reinterpret_cast<CreateRobotFunc>(sym);
-
-    RobotBase* robot = createRobot();
-
-    if (robot == nullptr){
-        std::cout << "Error creating robot." << std::endl;
+        *out << dlerror() <<std::endl;
         dlclose(handle);
         return nullptr;
     }
 
     robot_handles.push_back(handle);
-    return robot;
+    return reinterpret_cast<RobotFactory>(sym);
 }
 
-void Arena::setupRobot(RobotBase* robot, int index){
+void Arena::setupRobot(RobotBase* robot, int index, int& row, int& col){
     robot->set_boundaries(arenaHeight,arenaWidth);
 
     std::string characters = "@#$%&!*^~+";
     robot->m_character = characters[index % characters.length()];
 
-    int row, col;
-     
     do{
-        row = rand() % arenaHeight;
-        col = rand() % arenaWidth;
+        row = spawn_rng.below(arenaHeight);
+        col = spawn_rng.below(arenaWidth);
     } while (!cellEmpty(row, col));
 
+    place_robot(index, row, col);
     robot->move_to(row,col);
-    std::cout << "Loaded robot: " << robot->m_name << " at (" << row << ", " << col << ")\n";
+    if (!headless){
+        *out << "Loaded robot: " << robot->m_name << " at (" << row << ", " << col << ")\n";
+    }
     
 }
 
-void Arena::load_all_robots(){
-    std::cout << "Loading robots...\n";
+// Compiles and opens every robot library, up to max_robots of them. The libraries stay
+// open until cleanup(), so the factories can be used to build robots for many games.
+// Compiles run on up to compile_jobs threads. Builds are reported, and their libraries
+// opened, in file order as they finish, so no library past max_robots is ever opened.
+// A 'make bundle' build hands out the robots linked into the binary instead.
+std::vector<RobotFactory> Arena::load_robot_factories(){
+    std::vector<RobotFactory> factories;
+#ifdef ROBOTWARZ_STATIC_BUNDLE
+    // The robots were linked in by 'make bundle', so there is nothing to compile or open.
+    for (const BundledRobot* entry = bundled_robots; entry->name != nullptr; entry++){
+        if (maxRobots > 0 && factories.size() >= static_cast<size_t>(maxRobots)){
+            *out << "Reached max robot limit of " << maxRobots << "\n";
+            break;
+        }
+        *out << "Using bundled robot " << entry->name << "\n";
+        factories.push_back(entry->factory);
+    }
+#else
     std::vector<std::string> robot_files = find_robot_files();
+    size_t count = robot_files.size();
+
+    std::vector<RobotBuild> builds(count);
+    std::vector<char> finished(count, 0);
+    size_t next_build = 0;
+    bool enough = false;
+    std::mutex lock;
+    std::condition_variable build_done;
+
+    int jobs = compileJobs > 0 ? compileJobs : std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    for (int job = 0; job < jobs && static_cast<size_t>(job) < count; job++){
+        workers.emplace_back([&](){
+            while (true){
+                size_t index;
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (enough || next_build >= count){
+                        return;
+                    }
+                    index = next_build++;
+                }
 
-    for (const auto& filename : robot_files){
-        if (maxRobots > 0 && robots.size() >= static_cast<size_t>(maxRobots)){
-            std::cout << "Reached max robot limit of " << maxRobots << "\n";
-            break;
+                RobotBuild build = compileRobot(robot_files[index]);
+
+                std::lock_guard<std::mutex> guard(lock);
+                builds[index] = std::move(build);
+                finished[index] = 1;
+                build_done.notify_all();
+            }
+        });
+    }
+
+    size_t next_report = 0;
+    while (next_report < count && !enough){
+        RobotBuild build;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            build_done.wait(guard, [&](){
+                return finished[next_report] != 0;
+            });
+            build = std::move(builds[next_report]);
         }
 
-        std::string shared_lib = compileRobot(filename);
-        if (shared_lib.empty()){
-            continue;
+        // dlopen can take a while, so it runs without the lock the workers need.
+        *out << build.log;
+        if (build.ok){
+            RobotFactory factory = loadFactory(build.sharedLib);
+            if (factory != nullptr){
+                factories.push_back(factory);
+            }
+        }
+        next_report++;
+        if (maxRobots > 0 && factories.size() >= static_cast<size_t>(maxRobots) && next_report < count){
+            *out << "Reached max robot limit of " << maxRobots << "\n";
+            std::lock_guard<std::mutex> guard(lock);
+            enough = true;
         }
-        RobotBase* robot = loadRobot(shared_lib);
+    }
+
+    for (auto& worker : workers){
+        worker.join();
+    }
+#endif
+    return factories;
+}
+
+void Arena::load_all_robots(){
+    *out << "Loading robots...\n";
+
+    for (RobotFactory factory : load_robot_factories()){
+        RobotBase* robot = factory();
         if (robot == nullptr){
+            *out << "Error creating robot." << std::endl;
             continue;
         }
-
-        setupRobot(robot, robots.size());
-        robots.push_back(robot);
+        add_robot(robot);
     }
-    std::cout << "Loaded " << robots.size() << " robots\n";
+    *out << "Loaded " << robots.size() << " robots\n";
+}
+
+// Places a robot the arena now owns; it is deleted by cleanup().
+void Arena::add_robot(RobotBase* robot){
+    int row, col;
+    setupRobot(robot, robots.size(), row, col);
+    robots.push_back(robot);
+    damage_dealt.push_back(0);
+    death_round.push_back(0);
+    robot_characters.push_back(robot->m_character);
+    mirror_robot(robot, row, col);
+    robots_hash ^= robot_hash(robots.size() - 1);
+}
+
+// Adds the robot just pushed onto robots, which the caller has put at (row, col), to
+// the state mirror.
+void Arena::mirror_robot(RobotBase* robot, int row, int col){
+    int health = robot->get_health();
+    robot_row.push_back(row);
+    robot_col.push_back(col);
+    robot_health.push_back(health);
+    robot_armor.push_back(robot->get_armor());
+    robot_alive.push_back(health > 0);
+    living += health > 0;
 }
 
 RobotBase* Arena::findRobotAt(int row, int col){
-    for (const auto& robot : robots){
-        int robotRow, robotCol;
-        robot->get_current_location(robotRow, robotCol);
+    if (row < 0 || row >= arenaHeight || col < 0 || col >= arenaWidth){
+        return nullptr;
+    }
+    int index = occupancy[cell_index(row, col)];
+    if (index < 0){
+        return nullptr;
+    }
+    return robots[index];
+}
 
-        if (robotRow == row && robotCol == col){
-            return robot;
-        }
+int Arena::cell_index(int row, int col) const{
+    return (row + 1) * gridStride + (col + 1);
+}
+
+char Arena::terrain_at(int row, int col) const{
+    return terrain[cell_index(row, col)];
+}
+
+static size_t bit_word(int row, int col, int bitStride){
+    return static_cast<size_t>(row + 1) * bitStride + ((col + 1) >> 6);
+}
+
+static uint64_t bit_mask(int col){
+    return uint64_t(1) << ((col + 1) & 63);
+}
+
+void Arena::set_terrain(int row, int col, char type){
+    char& cell = terrain[cell_index(row, col)];
+    int at = row * arenaWidth + col;
+    if (cell != '.'){
+        terrain_hash ^= hash_key(hash_terrain, at, cell);
+    }
+    if (type != '.'){
+        terrain_hash ^= hash_key(hash_terrain, at, type);
     }
-    return nullptr;
+    cell = type;
+
+    // The terrain type itself is read from the terrain buffer; the plane only says
+    // whether there is any.
+    size_t word = bit_word(row, col, bitStride);
+    uint64_t mask = bit_mask(col);
+    terrain_bits[word] &= ~mask;
+    if (type != '.'){
+        terrain_bits[word] |= mask;
+    }
+    refresh_radar_cell(row, col);
+
+    // Any cached terrain scan is stale now.
+    clear_radar_cache();
+}
+
+// True when the cell holds terrain or a robot, i.e. anything a step or a scan has to look at.
+bool Arena::cell_busy(int row, int col) const{
+    size_t word = bit_word(row, col, bitStride);
+    return ((terrain_bits[word] | robot_bits[word]) & bit_mask(col)) != 0;
+}
+
+// Which line of a family a cell sits on, and how far along that line it is.
+// Diagonal positions are halved: neighbouring cells on a diagonal differ by 2 in
+// row + col (or row - col), and the lanes two lines over share the same halves.
+int Arena::radar_line(LineFamily family, int row, int col) const{
+    switch (family){
+        case line_rows:      return row;
+        case line_cols:      return col;
+        case line_diagonals: return row - col + arenaWidth - 1;
+        default:             return row + col;
+    }
+}
+
+int Arena::radar_pos(LineFamily family, int row, int col) const{
+    switch (family){
+        case line_rows:      return col;
+        case line_cols:      return row;
+        case line_diagonals: return (row + col) >> 1;
+        default:             return (row - col + arenaWidth - 1) >> 1;
+    }
+}
+
+void Arena::refresh_radar_cell(int row, int col){
+    bool busy = cell_busy(row, col);
+    bool robot = occupancy[cell_index(row, col)] >= 0;
+    for (int family = line_rows; family <= line_anti_diagonals; family++){
+        LineFamily f = static_cast<LineFamily>(family);
+        int line = radar_line(f, row, col);
+        int pos = radar_pos(f, row, col);
+        radar_lines[family].set(line, pos, busy);
+        robot_lines[family].set(line, pos, robot);
+    }
+}
+
+// Dead robots keep their cell (they still block movement and show up on radar),
+// so the index only changes when a robot is placed or moved.
+// Robots walking onto a pit or flamethrower don't check for other robots, so a cell
+// can hold more than one robot. Those are chained through next_in_cell in index
+// order so findRobotAt still returns the same robot the old linear scan did.
+void Arena::place_robot(int index, int row, int col){
+    if (next_in_cell.size() <= static_cast<size_t>(index)){
+        next_in_cell.resize(index + 1, -1);
+    }
+
+    int* link = &occupancy[cell_index(row, col)];
+    while (*link >= 0 && *link < index){
+        link = &next_in_cell[*link];
+    }
+    next_in_cell[index] = *link;
+    *link = index;
+    robot_bits[bit_word(row, col, bitStride)] |= bit_mask(col);
+    refresh_radar_cell(row, col);
+}
+
+void Arena::remove_robot(int index, int row, int col){
+    int* link = &occupancy[cell_index(row, col)];
+    while (*link >= 0 && *link != index){
+        link = &next_in_cell[*link];
+    }
+    if (*link == index){
+        *link = next_in_cell[index];
+        next_in_cell[index] = -1;
+    }
+    if (occupancy[cell_index(row, col)] < 0){
+        robot_bits[bit_word(row, col, bitStride)] &= ~bit_mask(col);
+        refresh_radar_cell(row, col);
+    }
+}
+
+void Arena::move_robot(int index, int new_row, int new_col){
+    int old_row = robot_row[index];
+    int old_col = robot_col[index];
+
+    robots_hash ^= hash_key(hash_position, index, static_cast<int64_t>(old_row) * arenaWidth + old_col) ^
+                   hash_key(hash_position, index, static_cast<int64_t>(new_row) * arenaWidth + new_col);
+    remove_robot(index, old_row, old_col);
+    place_robot(index, new_row, new_col);
+    if (replay != nullptr && (new_row != old_row || new_col != old_col)){
+        replay->move(index, new_row, new_col);
+    }
+    if (minimap.active()){
+        minimap.add_robot(old_row, old_col, index, robot_alive[index], -1);
+        minimap.add_robot(new_row, new_col, index, robot_alive[index], 1);
+    }
+    robots[index]->move_to(new_row, new_col);
+    robot_row[index] = new_row;
+    robot_col[index] = new_col;
 }
 
 void Arena::cleanup(){
     for (const auto robot : robots){
         delete robot;
     }
+    robots.clear();
+    robot_characters.clear();
+    robot_row.clear();
+    robot_col.clear();
+    robot_health.clear();
+    robot_armor.clear();
+    robot_alive.clear();
+    living = 0;
 
     for (const auto handle : robot_handles){
         dlclose(handle);
     }
+    robot_handles.clear();
 }
 
-int Arena::count_living_robots(){ 
-    int counter = 0;
-    for (auto robot : robots){
-        if (robot->get_health() > 0){
-            counter += 1;
+// Applies damage that has already been reduced by armor, then wears the armor down.
+// take_damage and reduce_armor clamp at 0, and the mirror does the same.
+void Arena::damage_robot(int index, int damage){
+    RobotBase* target = robots[index];
+    uint64_t old_hash = robot_hash(index);
+    robot_health[index] = target->take_damage(damage);
+    target->reduce_armor(1);
+    robot_armor[index] = std::max(0, robot_armor[index] - 1);
+    robots_hash ^= old_hash ^ robot_hash(index);
+    forget_states();
+    if (damage > 0){
+        last_damage_round = round;
+    }
+    if (replay != nullptr){
+        replay->damage(index, damage);
+    }
+
+    if (robot_alive[index] && robot_health[index] <= 0){
+        robot_alive[index] = 0;
+        living--;
+        death_round[index] = round;
+        if (replay != nullptr){
+            replay->death(index);
         }
+        if (minimap.active()){
+            minimap.add_robot(robot_row[index], robot_col[index], index, true, -1);
+            minimap.add_robot(robot_row[index], robot_col[index], index, false, 1);
+        }
+    }
+}
+
+int Arena::count_living_robots(){ 
+    return living;
+}
+
+// Hash of everything that decides how the game goes on from here: the terrain, and
+// where every robot is and its health, armor and grenades. Two runs of a game from the
+// same seed should have the same hash every round; see StateHash.h. Both parts are
+// kept up to date as the state changes, so this costs nothing per round.
+uint64_t Arena::state_hash(){
+    return terrain_hash ^ robots_hash;
+}
+
+// The keys of one robot's features. Anything that changes a robot XORs this out of
+// robots_hash before the change and back in after it.
+uint64_t Arena::robot_hash(int index){
+    return hash_key(hash_position, index, static_cast<int64_t>(robot_row[index]) * arenaWidth + robot_col[index]) ^
+           hash_key(hash_health, index, robot_health[index]) ^
+           hash_key(hash_armor, index, robot_armor[index]) ^
+           hash_key(hash_grenades, index, robots[index]->get_grenades());
+}
+
+// Health, armor and grenades only ever go down, so once one of them changes no state
+// from before can come back; only states since then need remembering.
+void Arena::forget_states(){
+    if (!seen_states.empty()){
+        seen_states.clear();
+    }
+}
+
+// A game is stuck when the state at the start of this round has been seen before, or
+// when nobody has taken damage for stalemate_rounds rounds. Robots keep their own
+// memory, which isn't hashed, so a repeat is a strong hint rather than a proof.
+bool Arena::stalemate_reached(){
+    if (stalemateRounds > 0 && round - last_damage_round > stalemateRounds){
+        stalemate_cause = stalemateRounds;
+        return true;
+    }
+    if (endOnRepeat && !seen_states.insert(state_hash())){
+        stalemate_cause = 0;
+        return true;
     }
-    return counter;   
+    return false;
 }
 
-void Arena::run_game(){
+// The log policy only changes what is printed, never how the game plays out.
+template <typename Log>
+MatchResult Arena::play_game(){
+    auto end_game = [&](){
+        if (live_view != nullptr){
+            publish_snapshot();
+            live_view->finish();
+        }
+        if constexpr (Log::enabled(log_game_over)){
+            if (stalemate){
+                log_event({record_stalemate, {stalemate_cause}});
+            }
+            declare_winner();
+        }
+        return match_result();
+    };
+
     round = 0;
+    round_hashes.clear();
+    round_hashes.reserve(maxRound);
+    steady_allocations = 0;
+    last_damage_round = 0;
+    stalemate = false;
+    forget_states();
     while (round < maxRound){
         round++;
-        std::cout << "=========== starting round " << round << " ===========" << std::endl;
-
-        display();
+        std::chrono::steady_clock::time_point round_start;
+        if (round_times != nullptr){
+            round_start = std::chrono::steady_clock::now();
+        }
+        uint64_t arena_allocations = allocation_count() - robot_allocations;
+        round_hashes.push_back(state_hash());
+        if (replay != nullptr){
+            if (replay->is_keyframe(round)){
+                fill_replay_robots();
+            }
+            replay->begin_round(round, replay_state, round_hashes.back());
+        }
+        if (live_view != nullptr){
+            publish_snapshot();
+        }
+        if constexpr (Log::enabled(log_turn)){
+            log_event({record_round, {round}});
+            log_board();
+        }
         if (count_living_robots() <= 1){
-            declare_winner();
-            return;
+            return end_game();
+        }
+        if ((stalemateRounds > 0 || endOnRepeat) && stalemate_reached()){
+            stalemate = true;
+            return end_game();
+        }
+        for (size_t i = 0; i < robots.size(); i++){
+            process_robot_turn<Log>(i);
         }
-        for (const auto robot: robots){
-            process_robot_turn(robot);
+        if (live_view != nullptr){
+            live_view->pace_round();
         }
-        if (watch_live){
+        else if (watch_live && !headless){
+            if (log_sink != nullptr){
+                log_sink->flush();
+            }
             sleep(1);
         }
+        // The first round is left to grow whatever buffers the game needs.
+        if (round > 1){
+            steady_allocations += allocation_count() - robot_allocations - arena_allocations;
+        }
+        if (round_times != nullptr){
+            round_times->push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - round_start).count());
+        }
+    }
+    return end_game();
+}
+
+MatchResult Arena::run_game(){
+    // The robots' rand() too, so the game depends on the seed alone; see RobotRand.h.
+    seed_robot_rand(seed);
+    prepare_radar_cache();
+    if (replay != nullptr){
+        start_replay();
+    }
+
+    MatchResult result;
+    if (headless){
+        result = play_game<SilentLog>();
+    }
+    else if (use_live_view){
+        LiveView view(watchFps, watchRoundMs);
+        live_view = &view;
+        start_minimap();
+        result = play_game<WatchLog>();
+        minimap = Minimap();
+        live_view = nullptr;
+    }
+    else{
+        if (log_sink != nullptr){
+            log_sink->reserve_boards(static_cast<size_t>(arenaHeight) * arenaWidth);
+        }
+        result = play_game<ArenaLog>();
+        if (log_sink != nullptr){
+            log_sink->flush();
+        }
     }
-    declare_winner();
+
+    if (replay != nullptr){
+        replay->finish(result.final_hash);
+    }
+    return result;
 }
 
-void Arena::process_robot_turn(RobotBase* robot){
-    int row,col;
-    robot->get_current_location(row, col);
+// Where every robot is and how it's doing, as the replay stores it.
+// Filled in place so keyframes reuse the same entries and names every time.
+void Arena::fill_replay_robots(){
+    replay_state.resize(robots.size());
+    for (size_t i = 0; i < robots.size(); i++){
+        ReplayRobot& entry = replay_state[i];
+        entry.name = robots[i]->m_name;
+        entry.character = robots[i]->m_character;
+        entry.row = robot_row[i];
+        entry.col = robot_col[i];
+        entry.health = robot_health[i];
+        entry.armor = robot_armor[i];
+    }
+}
+
+void Arena::start_replay(){
+    std::vector<ReplayTerrain> cells;
+    for (int row = 0; row < arenaHeight; row++){
+        for (int col = 0; col < arenaWidth; col++){
+            char type = terrain_at(row, col);
+            if (type != '.'){
+                cells.push_back({row, col, type});
+            }
+        }
+    }
+    fill_replay_robots();
+    replay->begin(seed, arenaHeight, arenaWidth, maxRound, cells, replay_state);
+}
 
-    if (robot->get_health() <= 0){
-        std::cout << robot->m_name << " is out.\n";
+// Stands in for a recorded robot when a replay is shown. It only carries the state
+// display() looks at; the replay says where it goes, so it never gets a turn.
+class ReplayStandIn : public RobotBase {
+    public:
+    explicit ReplayStandIn(int armor) : RobotBase(2, armor, railgun){}
+    void get_radar_direction(int& radar_direction) override{
+        radar_direction = 0;
+    }
+    void process_radar_results(const std::vector<RadarObj>&) override{}
+    bool get_shot_location(int&, int&) override{
+        return false;
+    }
+    void get_move_direction(int& direction, int& distance) override{
+        direction = 0;
+        distance = 0;
+    }
+};
+
+// Sets the arena up as the replay's board, with no robots. Nothing is compiled or
+// loaded; show_replay_state() puts stand-ins where the recorded robots were.
+void Arena::load_replay(const ReplayReader& reader){
+    cleanup();
+    arenaHeight = reader.rows();
+    arenaWidth = reader.cols();
+    maxRound = reader.max_rounds();
+    seed = reader.seed();
+    size_grid();
+    for (const ReplayTerrain& cell : reader.terrain()){
+        if (cell.row >= 0 && cell.row < arenaHeight && cell.col >= 0 && cell.col < arenaWidth){
+            set_terrain(cell.row, cell.col, cell.type);
+        }
+    }
+}
+
+// Takes the arena size, round limit, obstacle counts and number of robots from a
+// recording, so rerunning its seed plays the same game whatever config.txt says now.
+void Arena::use_replay_settings(const ReplayReader& reader){
+    arenaHeight = reader.rows();
+    arenaWidth = reader.cols();
+    maxRound = reader.max_rounds();
+    maxRobots = reader.robots().size();
+    mounds = pits = flamethrowers = 0;
+    for (const ReplayTerrain& cell : reader.terrain()){
+        mounds += cell.type == 'M';
+        pits += cell.type == 'P';
+        flamethrowers += cell.type == 'F';
+    }
+    size_grid();
+}
+
+std::vector<std::string> Arena::robot_names() const{
+    std::vector<std::string> names;
+    for (const RobotBase* robot : robots){
+        names.push_back(robot->m_name);
+    }
+    return names;
+}
+
+void Arena::show_replay_state(const ReplayState& state){
+    for (size_t i = 0; i < robots.size(); i++){
+        int row = robot_row[i];
+        int col = robot_col[i];
+        if (row >= 0 && row < arenaHeight && col >= 0 && col < arenaWidth){
+            remove_robot(i, row, col);
+        }
+    }
+    cleanup();
+
+    round = state.round;
+    for (const ReplayRobot& entry : state.robots){
+        int index = robots.size();
+        RobotBase* robot = new ReplayStandIn(entry.armor);
+        robot->m_name = entry.name;
+        robot->m_character = entry.character;
+        robot->set_boundaries(arenaHeight, arenaWidth);
+        robot->take_damage(100 - entry.health);
+        robot->move_to(entry.row, entry.col);
+        robots.push_back(robot);
+        robot_characters.push_back(robot->m_character);
+        mirror_robot(robot, entry.row, entry.col);
+        if (entry.row >= 0 && entry.row < arenaHeight && entry.col >= 0 && entry.col < arenaWidth){
+            place_robot(index, entry.row, entry.col);
+        }
+    }
+    damage_dealt.assign(robots.size(), 0);
+    death_round.assign(robots.size(), 0);
+}
+
+// Calls into the robot's own code. What it allocates is the robot's business, so
+// alloc_check builds count it apart from the arena's allocations.
+template <typename Call>
+void Arena::robot_call(Call&& call){
+    uint64_t before = allocation_count();
+    call();
+    robot_allocations += allocation_count() - before;
+}
+
+template <typename Log>
+void Arena::process_robot_turn(int index){
+    RobotBase* robot = robots[index];
+    int row = robot_row[index];
+    int col = robot_col[index];
+
+    if (!robot_alive[index]){
+        if constexpr (Log::enabled(log_turn)){
+            log_event({record_out, {}, &robot->m_name});
+        }
         return;
     }
 
-    std::cout << robot->m_name << " begins turn. \n";
-    std::cout << "Current health: " << robot->get_health() << "\n";
-    std::cout << "Current armor: " << robot->get_armor() << "\n";
-    std::cout << "Current move speed: " << robot->get_move_speed() << "\n";
-    std::cout << "Current location: (" << row << "," << col << ")\n";
+    if constexpr (Log::enabled(log_turn)){
+        log_event({record_turn, {robot_health[index], robot_armor[index], robot->get_move_speed(), row, col},
+                   &robot->m_name});
+    }
 
     int radarDirection;
-    robot->get_radar_direction(radarDirection);
-
-    std::vector<RadarObj> radarResults;
-    get_radar_results(robot, radarDirection, radarResults);
-    if (radarResults.empty()){
-        std::cout << "Found nothing.\n";
+    robot_call([&](){ robot->get_radar_direction(radarDirection); });
+    if (replay != nullptr){
+        replay->radar(index, radarDirection);
     }
-    else{
-    std::cout << "Radar results:\n";
-    for (const auto& obj : radarResults) {
-        std::cout << "  - Found '" << obj.m_type 
-                  << "' at (" << obj.m_row << "," << obj.m_col << ")\n";
+
+    std::vector<RadarObj>& radarResults = radar_results;
+    get_radar_results(index, radarDirection, radarResults);
+    if constexpr (Log::enabled(log_radar)){
+        if (radarResults.empty()){
+            log_event({record_found_nothing});
+        }
+        else{
+            log_event({record_radar_header});
+            for (const auto& obj : radarResults) {
+                log_event({record_radar_hit, {obj.m_type, obj.m_row, obj.m_col}});
+            }
         }
     }
 
-    robot->process_radar_results(radarResults);
+    robot_call([&](){ robot->process_radar_results(radarResults); });
     int shotRow, shotCol;
-    bool result = robot->get_shot_location(shotRow, shotCol);
+    bool result;
+    robot_call([&](){ result = robot->get_shot_location(shotRow, shotCol); });
     if (result == true){
-        std::cout << "Shooting: " << robot->get_weapon() << "\n"; 
-        handle_shot(robot, shotRow, shotCol);
+        if constexpr (Log::enabled(log_shot)){
+            log_event({record_shooting, {robot->get_weapon()}});
+        }
+        handle_shot<Log>(index, shotRow, shotCol);
     }
     else{
         int moveDirection, moveDistance;
-        robot->get_move_direction(moveDirection, moveDistance);
-        std::cout << "Moving: " << robot->m_name << "\n";
-        handle_movement(robot, moveDirection, moveDistance);
+        robot_call([&](){ robot->get_move_direction(moveDirection, moveDistance); });
+        if constexpr (Log::enabled(log_movement)){
+            log_event({record_moving, {}, &robot->m_name});
+        }
+        handle_movement<Log>(index, moveDirection, moveDistance);
     }
 }
 
-void Arena::declare_winner(){
-    RobotBase* winner = nullptr;
+// The winner is the last robot standing, or the healthiest one when max rounds runs out.
+MatchResult Arena::match_result(){
+    MatchResult result;
+    result.rounds = round;
+    result.stalemate = stalemate;
+    result.winner = -1;
+    result.living = 0;
+
     int highest_health = 0;
-    int living_count = 0;
-    
-    for (auto robot : robots){
-        if (robot->get_health() > 0){
-            living_count++;
-            if (robot->get_health() > highest_health){
-                highest_health = robot->get_health();
-                winner = robot;
+    for (size_t i = 0; i < robots.size(); i++){
+        RobotBase* robot = robots[i];
+        int health = robot_health[i];
+        if (health > 0){
+            result.living++;
+            if (health > highest_health){
+                highest_health = health;
+                result.winner = i;
             }
         }
+        int survived = (health > 0 || death_round[i] == 0) ? round : death_round[i];
+        result.robots.push_back({robot->m_name, health, survived, damage_dealt[i]});
     }
-    std::cout << "\n========== GAME OVER ==========" << std::endl;
-    
-    if (living_count == 0){
-        std::cout << "Draw - all robots destroyed!" << std::endl;
+    result.round_hashes = round_hashes;
+    result.final_hash = state_hash();
+    result.steady_allocations = steady_allocations;
+    return result;
+}
+
+void Arena::declare_winner(){
+    MatchResult result = match_result();
+    RobotBase* winner = result.winner >= 0 ? robots[result.winner] : nullptr;
+    int highest_health = winner != nullptr ? robot_health[result.winner] : 0;
+
+    log_event({record_game_over, {result.living, highest_health}, winner != nullptr ? &winner->m_name : nullptr});
+}
+
+// How many board cells fit on the terminal under the live view's headers, with room
+// for the status lines.
+void Arena::live_grid_size(int& rows, int& cols){
+    int label_width = std::max<int>(2, std::to_string(arenaHeight - 1).size());
+    rows = std::max(5, live_view->screen_rows() - static_cast<int>(robots.size()) - 6);
+    cols = std::max(8, (live_view->screen_cols() - label_width - 2) / 3);
+}
+
+// Arenas bigger than the terminal are shown as a minimap. Its counts are built here
+// once and kept up to date by move_robot and damage_robot from then on.
+void Arena::start_minimap(){
+    minimap = Minimap();
+    int rows, cols;
+    live_grid_size(rows, cols);
+    if (arenaHeight <= rows && arenaWidth <= cols){
+        return;
+    }
+
+    minimap.reset(arenaHeight, arenaWidth, (arenaHeight + rows - 1) / rows, (arenaWidth + cols - 1) / cols);
+    for (int row = 0; row < arenaHeight; row++){
+        for (int col = 0; col < arenaWidth; col++){
+            if (terrain_at(row, col) != '.'){
+                minimap.add_terrain(row, col);
+            }
+        }
+    }
+    for (size_t i = 0; i < robots.size(); i++){
+        minimap.add_robot(robot_row[i], robot_col[i], i, robot_alive[i], 1);
     }
-    else if (living_count == 1){
-        std::cout << winner->m_name << " wins!" << std::endl;
+}
+
+// Fills cells with the board inside a window of the arena. Cells start out as terrain
+// and each robot is then written over its own cell, so there's no robot lookup per
+// cell. Stacked robots show the one display() would.
+void Arena::window_cells(int first_row, int first_col, int rows, int cols, std::vector<uint16_t>& cells){
+    cells.resize(static_cast<size_t>(rows) * cols);
+    for (int row = 0; row < rows; row++){
+        for (int col = 0; col < cols; col++){
+            cells[row * cols + col] = cell_terrain | static_cast<unsigned char>(terrain_at(first_row + row, first_col + col));
+        }
+    }
+    for (size_t i = 0; i < robots.size(); i++){
+        int row = robot_row[i];
+        int col = robot_col[i];
+        if (row < first_row || row >= first_row + rows || col < first_col || col >= first_col + cols){
+            continue;
+        }
+        int shown = occupancy[cell_index(row, col)];
+        if (shown >= 0){
+            uint16_t kind = robot_alive[shown] ? cell_robot : cell_dead_robot;
+            cells[(row - first_row) * cols + col - first_col] = kind | static_cast<unsigned char>(robots[shown]->m_character);
+        }
+    }
+}
+
+// Copies the board and a status line per robot into the live view's back snapshot and
+// hands it to the render thread. Big arenas show either the minimap or a full size
+// window around the robot the viewer is following, so the cost stays in proportion to
+// the screen rather than the arena.
+void Arena::publish_snapshot(){
+    ArenaSnapshot& snapshot = live_view->back_snapshot();
+    snapshot.round = round;
+    int follow = live_view->followed_robot();
+
+    if (!minimap.active()){
+        snapshot.rows = arenaHeight;
+        snapshot.cols = arenaWidth;
+        snapshot.first_row = snapshot.first_col = 0;
+        snapshot.row_step = snapshot.col_step = 1;
+        window_cells(0, 0, arenaHeight, arenaWidth, snapshot.cells);
+    }
+    else if (follow >= 0 && follow < static_cast<int>(robots.size())){
+        int rows, cols;
+        live_grid_size(rows, cols);
+        rows = std::min(rows, arenaHeight);
+        cols = std::min(cols, arenaWidth);
+        int row = robot_row[follow];
+        int col = robot_col[follow];
+        snapshot.rows = rows;
+        snapshot.cols = cols;
+        snapshot.first_row = std::clamp(row - rows / 2, 0, arenaHeight - rows);
+        snapshot.first_col = std::clamp(col - cols / 2, 0, arenaWidth - cols);
+        snapshot.row_step = snapshot.col_step = 1;
+        window_cells(snapshot.first_row, snapshot.first_col, rows, cols, snapshot.cells);
+    }
+    else{
+        snapshot.rows = minimap.rows();
+        snapshot.cols = minimap.cols();
+        snapshot.first_row = snapshot.first_col = 0;
+        snapshot.row_step = minimap.block_rows();
+        snapshot.col_step = minimap.block_cols();
+        minimap.glyphs(robot_characters, snapshot.cells);
+    }
+
+    // Written into the lines already there, which keep their capacity from round to round.
+    std::vector<std::string>& status = snapshot.status;
+    status.resize(robots.size());
+    for (int i = 0; i < static_cast<int>(robots.size()); i++){
+        RobotBase* robot = robots[i];
+        char numbers[64];
+        snprintf(numbers, sizeof(numbers), " health %-4d armor %d%s", robot_health[i], robot_armor[i],
+                 i == follow && minimap.active() ? "  (following)" : "");
+        std::string& line = status[i];
+        line.assign(1, robot->m_character);
+        line += ' ';
+        line += robot->m_name;
+        if (robot->m_name.size() < 16){
+            line.append(16 - robot->m_name.size(), ' ');
+        }
+        line += numbers;
+    }
+
+    live_view->publish();
+}
+
+// Game output goes through the log sink when there is one, otherwise straight to out.
+void Arena::log_event(const LogRecord& record){
+    if (log_sink != nullptr){
+        log_sink->post(record);
     }
     else{
-        // Multiple robots alive (max rounds reached)
-        std::cout << winner->m_name << " wins with " << highest_health << " health remaining!" << std::endl;
+        write_log_record(*out, record);
+    }
+}
+
+// The sink can't look at the arena later, so it gets a copy of the board's cells in
+// one of its slots and turns them into text on its own thread.
+void Arena::log_board(){
+    if (log_sink == nullptr){
+        display();
+        return;
+    }
+    int slot = log_sink->claim_board();
+    if (slot < 0){
+        return;
     }
+    window_cells(0, 0, arenaHeight, arenaWidth, log_sink->board(slot));
+    log_sink->post({record_board, {arenaHeight, arenaWidth, slot}});
 }
 
-void Arena::handle_movement(RobotBase* robot, int direction, int distance){
-    int currentRow, currentCol;
-    robot->get_current_location(currentRow, currentCol);
+template <typename Log>
+void Arena::handle_movement(int index, int direction, int distance){
+    RobotBase* robot = robots[index];
+    int currentRow = robot_row[index];
+    int currentCol = robot_col[index];
 
     if (direction == 0 || distance == 0){
-        std::cout << robot->m_name << " stays in place." << std::endl;
+        if constexpr (Log::enabled(log_movement)){
+            log_event({record_stays, {}, &robot->m_name});
+        }
         return;
     }
     int maxSpeed = robot->get_move_speed();
@@ -414,39 +1227,51 @@ void Arena::handle_movement(RobotBase* robot, int direction, int distance){
                 break;
             }
             
-            char cell = grid[next_row][next_col];
+            if (!cell_busy(next_row, next_col)){
+                currentRow = next_row;
+                currentCol = next_col;
+                continue;
+            }
+
+            char cell = terrain_at(next_row, next_col);
             
             if (cell == 'M'){
-                std::cout << robot->m_name << " blocked by mound." << std::endl;
+                if constexpr (Log::enabled(log_movement)){
+                    log_event({record_blocked_mound, {}, &robot->m_name});
+                }
                 break;
             }
             else if (cell == 'P'){
                 currentRow = next_row;
                 currentCol = next_col;
                 robot->disable_movement();
-                std::cout << robot->m_name << " fell into a pit!" << std::endl;
+                if constexpr (Log::enabled(log_movement)){
+                    log_event({record_fell_in_pit, {}, &robot->m_name});
+                }
                 break;
             }
             else if (cell == 'F'){
                 currentRow = next_row;
                 currentCol = next_col;
                 
-                int damage = rand() % 21 + 30;
+                int damage = damage_rng.range(30, 50);
                 
-                int armor = robot->get_armor();
+                int armor = robot_armor[index];
                 damage = damage * (100 - armor * 10) / 100;
                 
-                robot->take_damage(damage);
-                robot->reduce_armor(1);
+                damage_robot(index, damage);
                 
-                std::cout << robot->m_name << " hit by flamethrower! Takes " 
-                        << damage << " damage." << std::endl;
+                if constexpr (Log::enabled(log_damage)){
+                    log_event({record_flame_damage, {damage}, &robot->m_name});
+                }
                 
             }
             else{
                 RobotBase* other = findRobotAt(next_row, next_col);
                 if (other != nullptr){
-                    std::cout << robot->m_name << " blocked by " << other->m_name << "." << std::endl;
+                    if constexpr (Log::enabled(log_movement)){
+                        log_event({record_blocked_robot, {}, &robot->m_name, &other->m_name});
+                    }
                     break;
                 }
                 
@@ -455,120 +1280,311 @@ void Arena::handle_movement(RobotBase* robot, int direction, int distance){
             }
         }
         
-        robot->move_to(currentRow, currentCol);
-        std::cout << robot->m_name << " moves to (" << currentRow << "," << currentCol << ")" << std::endl;
+        move_robot(index, currentRow, currentCol);
+        if constexpr (Log::enabled(log_movement)){
+            log_event({record_moved, {currentRow, currentCol}, &robot->m_name});
+        }
 }
 
-void Arena::get_radar_results(RobotBase* robot, int direction, std::vector<RadarObj>& results){
-    results.clear();
-    
-    int robot_row, robot_col;
-    robot->get_current_location(robot_row, robot_col);
-    
+// Adds whatever the radar sees in one cell: terrain first, then a robot other than the
+// scanner, robots[scanner]. Cells in the padding border are always empty, so callers
+// don't need to bounds check.
+void Arena::radar_check_cell(int scanner, int row, int col, std::vector<RadarObj>& results){
+    int index = cell_index(row, col);
+
+    char cell = terrain[index];
+    if (cell == 'M' || cell == 'P' || cell == 'F'){
+        results.push_back(RadarObj(cell, row, col));
+    }
+
+    int other_index = occupancy[index];
+    if (other_index >= 0 && other_index != scanner){
+        if (robot_alive[other_index]){
+            results.push_back(RadarObj('R', row, col));
+        }
+        else{
+            results.push_back(RadarObj('X', row, col));
+        }
+    }
+}
+
+// Perpendicular used to widen a ray to three lanes, and the line family the lanes lie on.
+static void radar_side(int direction, int& side_row, int& side_col, LineFamily& family){
+    int delta_row = directions[direction].first;
+    int delta_col = directions[direction].second;
+
+    if (delta_row == 0){
+        side_row = 1;
+        side_col = 0;
+        family = line_rows;
+    }
+    else if (delta_col == 0){
+        side_row = 0;
+        side_col = 1;
+        family = line_cols;
+    }
+    else{  // Diagonal direction - perpendicular is (-delta_col, delta_row)
+        side_row = -delta_col;
+        side_col = delta_row;
+        family = (delta_row == delta_col) ? line_diagonals : line_anti_diagonals;
+    }
+}
+
+// Calls visit(step, centre_row, centre_col) for every step of a directional ray where
+// one of the three lanes is set in the given planes, in the order the ray travels.
+// With centre_only the side lanes are ignored and the ray is one cell wide.
+template <typename Visit>
+void Arena::scan_ray(const LinePlane* planes, int row, int col, int direction, bool centre_only, Visit&& visit){
+    int delta_row = directions[direction].first;
+    int delta_col = directions[direction].second;
+
+    int side_row, side_col;
+    LineFamily family;
+    radar_side(direction, side_row, side_col, family);
+
+    // The ray runs until its centre cell leaves the arena.
+    int steps = std::max(arenaHeight, arenaWidth);
+    if (delta_row > 0) steps = std::min(steps, arenaHeight - 1 - row);
+    if (delta_row < 0) steps = std::min(steps, row);
+    if (delta_col > 0) steps = std::min(steps, arenaWidth - 1 - col);
+    if (delta_col < 0) steps = std::min(steps, col);
+    if (steps <= 0){
+        return;
+    }
+
+    // All three lanes lie on lines of the same family and advance one position per
+    // step, so they can be ORed together and only the busy steps visited.
+    const LinePlane& plane = planes[family];
+    const uint64_t* lane_centre = plane.line(radar_line(family, row, col));
+    const uint64_t* lane_left = centre_only ? lane_centre : plane.line(radar_line(family, row - side_row, col - side_col));
+    const uint64_t* lane_right = centre_only ? lane_centre : plane.line(radar_line(family, row + side_row, col + side_col));
+
+    int origin = radar_pos(family, row, col);
+    int sign = radar_pos(family, row + delta_row, col + delta_col) - origin;
+    int first = std::min(origin + sign, origin + sign * steps);
+    int last = std::max(origin + sign, origin + sign * steps);
+
+    scan_lanes(lane_left, lane_centre, lane_right, first, last, sign > 0, [&](int pos){
+        int step = (pos - origin) * sign;
+        visit(step, row + delta_row * step, col + delta_col * step);
+    });
+}
+
+void Arena::clear_radar_cache(){
+    radar_cache_slots.clear();
+    radar_cache_pool.clear();
+    radar_cache_off = false;
+}
+
+// Terrain never changes once the obstacles are placed, so the terrain part of a scan
+// from a cell in a direction is the same every time. The first scan from each (cell,
+// direction) keeps its terrain hits in a shared pool of RadarObj and later ones copy
+// them back out, so a short game only pays for the scans it makes. The memory is all
+// taken before the game: the slots, and the pool reserved to whatever of radarCacheMB
+// they leave. The cache is turned off when radarCacheMB is 0, there is no terrain to
+// cache, or the slots alone don't fit.
+void Arena::prepare_radar_cache(){
+    if (radarCacheMB <= 0 || radar_cache_off){
+        return;
+    }
+    size_t slots = static_cast<size_t>(arenaHeight) * arenaWidth * 9;
+    size_t slot_bytes = std::max(slots, radar_cache_slots.capacity()) * sizeof(RadarCacheSlot);
+    size_t budget = static_cast<size_t>(radarCacheMB) * 1024 * 1024;
+    bool any_terrain = std::any_of(terrain_bits.begin(), terrain_bits.end(), [](uint64_t word){ return word != 0; });
+    if (!any_terrain || slot_bytes > budget){
+        radar_cache_off = true;
+        return;
+    }
+    if (radar_cache_slots.empty()){
+        radar_cache_slots.assign(slots, RadarCacheSlot{radar_cache_empty, 0});
+    }
+    // Reserved every game, since a copied arena keeps its cached scans but not the
+    // pool's spare capacity. No scan finds more than three lanes of terrain.
+    size_t most_hits = slots * 3 * std::max(arenaHeight, arenaWidth);
+    size_t room = (budget - slot_bytes) / sizeof(RadarObj);
+    radar_cache_pool.reserve(std::min({room, most_hits, static_cast<size_t>(radar_cache_empty - 1)}));
+}
+
+// Returns the slot for a scan, or nullptr when the cache is off.
+Arena::RadarCacheSlot* Arena::radar_cache_slot(int row, int col, int direction){
+    if (radarCacheMB <= 0 || radar_cache_off){
+        return nullptr;
+    }
+    if (radar_cache_slots.empty()){
+        prepare_radar_cache();
+        if (radar_cache_off){
+            return nullptr;
+        }
+    }
+    return &radar_cache_slots[static_cast<size_t>(row * arenaWidth + col) * 9 + direction];
+}
+
+// Keeps the terrain hits of a scan that has just been made on the fly. Once the pool
+// is full, further slots stay empty and their scans stay on the fly.
+void Arena::cache_radar_terrain(RadarCacheSlot& slot, const std::vector<RadarObj>& results){
+    size_t terrain_hits = 0;
+    for (const RadarObj& obj : results){
+        terrain_hits += obj.m_type != 'R' && obj.m_type != 'X';
+    }
+    if (radar_cache_pool.size() + terrain_hits > radar_cache_pool.capacity() ||
+        radar_cache_pool.size() + terrain_hits >= radar_cache_empty){
+        return;
+    }
+    slot.start = radar_cache_pool.size();
+    slot.count = terrain_hits;
+    for (const RadarObj& obj : results){
+        if (obj.m_type != 'R' && obj.m_type != 'X'){
+            radar_cache_pool.push_back(obj);
+        }
+    }
+}
+
+// Position of an object within a scan from (row, col): step along the ray times three
+// plus the lane, or the neighbour number for the all-around scan. Terrain and robots
+// in the same cell share an order and terrain is listed first.
+int Arena::radar_order(int direction, int row, int col, const RadarObj& obj) const{
+    int d_row = obj.m_row - row;
+    int d_col = obj.m_col - col;
+
     if (direction == 0){
-        for (int dir = 1; dir <= 8; dir++){
-            int check_row = robot_row + directions[dir].first;
-            int check_col = robot_col + directions[dir].second;
-            
-            if (check_row < 0 || check_row >= arenaHeight ||
-                check_col < 0 || check_col >= arenaWidth){
-                continue;
+        static constexpr int neighbour_order[9] = {8, 1, 2, 7, 0, 3, 6, 5, 4};
+        return neighbour_order[(d_row + 1) * 3 + (d_col + 1)];
+    }
+
+    int delta_row = directions[direction].first;
+    int delta_col = directions[direction].second;
+    int side_row, side_col;
+    LineFamily family;
+    radar_side(direction, side_row, side_col, family);
+
+    // Solve (d_row, d_col) = step * delta + offset * side.
+    int det = delta_row * side_col - delta_col * side_row;
+    int step = (d_row * side_col - d_col * side_row) / det;
+    int offset = (delta_row * d_col - delta_col * d_row) / det;
+    return step * 3 + (offset + 1);
+}
+
+// What robots[index] sees scanning in direction, nearest first.
+void Arena::get_radar_results(int index, int direction, std::vector<RadarObj>& results){
+    results.clear();
+
+    int origin_row = robot_row[index];
+    int origin_col = robot_col[index];
+
+    RadarCacheSlot* slot = radar_cache_slot(origin_row, origin_col, direction);
+    if (slot != nullptr && slot->start != radar_cache_empty){
+        // Terrain comes straight out of the cache; only robots need looking for.
+        radar_overlay.clear();
+        auto add_robot = [&](int row, int col){
+            int other_index = occupancy[cell_index(row, col)];
+            if (other_index >= 0 && other_index != index){
+                radar_overlay.push_back(RadarObj(robot_alive[other_index] ? 'R' : 'X', row, col));
             }
-            
-            char cell = grid[check_row][check_col];
-            if (cell == 'M' || cell == 'P' || cell == 'F'){
-                results.push_back(RadarObj(cell, check_row, check_col));
+        };
+
+        if (direction == 0){
+            for (int dir = 1; dir <= 8; dir++){
+                add_robot(origin_row + directions[dir].first, origin_col + directions[dir].second);
             }
-            
-            RobotBase* other = findRobotAt(check_row, check_col);
-            if (other != nullptr && other != robot){
-                if (other->get_health() > 0){
-                    results.push_back(RadarObj('R', check_row, check_col));
-                }
-                else{
-                    results.push_back(RadarObj('X', check_row, check_col));
+        }
+        else{
+            int side_row, side_col;
+            LineFamily family;
+            radar_side(direction, side_row, side_col, family);
+            scan_ray(robot_lines, origin_row, origin_col, direction, false, [&](int, int current_row, int current_col){
+                for (int offset = -1; offset <= 1; offset++){
+                    add_robot(current_row + (side_row * offset), current_col + (side_col * offset));
                 }
+            });
+        }
+
+        const RadarObj* terrain_hit = radar_cache_pool.data() + slot->start;
+        const RadarObj* terrain_end = terrain_hit + slot->count;
+
+        if (radar_overlay.empty()){
+            results.assign(terrain_hit, terrain_end);
+            return;
+        }
+
+        results.reserve((terrain_end - terrain_hit) + radar_overlay.size());
+        for (const auto& obj : radar_overlay){
+            int order = radar_order(direction, origin_row, origin_col, obj);
+            while (terrain_hit != terrain_end && radar_order(direction, origin_row, origin_col, *terrain_hit) <= order){
+                results.push_back(*terrain_hit++);
             }
+            results.push_back(obj);
+        }
+        results.insert(results.end(), terrain_hit, terrain_end);
+        return;
+    }
+    
+    if (direction == 0){
+        for (int dir = 1; dir <= 8; dir++){
+            radar_check_cell(index, origin_row + directions[dir].first, origin_col + directions[dir].second, results);
         }
     }
     else{
-        int delta_row = directions[direction].first;
-        int delta_col = directions[direction].second;
-        
         int side_row, side_col;
-        if (delta_row == 0){
-            side_row = 1;
-            side_col = 0;
-        }
-        else if (delta_col == 0){
-            side_row = 0;
-            side_col = 1;
-        }
-        else{  // Diagonal direction - perpendicular is (-delta_col, delta_row)
-            side_row = -delta_col;
-            side_col = delta_row;
-        }
-
-        int current_row = robot_row;
-        int current_col = robot_col;
-        
-        while (true){
-            current_row += delta_row;
-            current_col += delta_col;
-            
-            if (current_row < 0 || current_row >= arenaHeight ||
-                current_col < 0 || current_col >= arenaWidth){
-                break;
-            }
-            
+        LineFamily family;
+        radar_side(direction, side_row, side_col, family);
+        scan_ray(radar_lines, origin_row, origin_col, direction, false, [&](int, int current_row, int current_col){
             for (int offset = -1; offset <= 1; offset++){
-                int check_row = current_row + (side_row * offset);
-                int check_col = current_col + (side_col * offset);
-                
-                if (check_row < 0 || check_row >= arenaHeight ||
-                    check_col < 0 || check_col >= arenaWidth){
-                    continue;
-                }
-                
-                char cell = grid[check_row][check_col];
-                if (cell == 'M' || cell == 'P' || cell == 'F'){
-                    results.push_back(RadarObj(cell, check_row, check_col));
-                }
-                
-                RobotBase* other = findRobotAt(check_row, check_col);
-                if (other != nullptr && other != robot){
-                    if (other->get_health() > 0){
-                        results.push_back(RadarObj('R', check_row, check_col));
-                    }
-                    else{
-                        results.push_back(RadarObj('X', check_row, check_col));
-                    }
-                }
+                radar_check_cell(index, current_row + (side_row * offset), current_col + (side_col * offset), results);
             }
-        }
+        });
+    }
+    if (slot != nullptr){
+        cache_radar_terrain(*slot, results);
     }
 }
 
 int Arena::calculate_damage(WeaponType weapon){
     switch(weapon){
         case flamethrower:
-            return rand() % 21 + 30;  // 30-50
+            return damage_rng.range(30, 50);
         case railgun:
-            return rand() % 11 + 10;  // 10-20
+            return damage_rng.range(10, 20);
         case grenade:
-            return rand() % 31 + 10;  // 10-40
+            return damage_rng.range(10, 40);
         case hammer:
-            return rand() % 11 + 50;  // 50-60
+            return damage_rng.range(50, 60);
         default:
             return 10;
     }
 }
 
-void Arena::handle_shot(RobotBase* robot, int shot_row, int shot_col){
-    int shooter_row, shooter_col;
-    robot->get_current_location(shooter_row, shooter_col);
+// Damages whatever robot other than the shooter stands in the cell. Returns true on a hit.
+template <typename Log>
+bool Arena::hit_cell(int shooter, WeaponType weapon, int row, int col){
+    int target_index = occupancy[cell_index(row, col)];
+    if (target_index < 0 || target_index == shooter){
+        return false;
+    }
+
+    int damage = calculate_damage(weapon);
+    
+    int armor = robot_armor[target_index];
+    damage = damage * (100 - armor * 10) / 100;
+    
+    damage_robot(target_index, damage);
+    damage_dealt[shooter] += damage;
+    
+    if constexpr (Log::enabled(log_damage)){
+        log_event({record_damage, {damage, robot_health[target_index]}, &robots[target_index]->m_name});
+    }
+    return true;
+}
+
+template <typename Log>
+void Arena::handle_shot(int index, int shot_row, int shot_col){
+    RobotBase* robot = robots[index];
+    int shooter_row = robot_row[index];
+    int shooter_col = robot_col[index];
     
     WeaponType weapon = robot->get_weapon();
+    if (replay != nullptr){
+        replay->shot(index, shot_row, shot_col);
+    }
     
     int delta_row = 0;
     int delta_col = 0;
@@ -578,100 +1594,70 @@ void Arena::handle_shot(RobotBase* robot, int shot_row, int shot_col){
     
     if (shot_col > shooter_col) delta_col = 1;
     else if (shot_col < shooter_col) delta_col = -1;
-    
-    std::vector<std::pair<int, int>> affected_cells;
+
+    int direction = stencil_direction(delta_row, delta_col);
+    bool hit_something = false;
     
     if (weapon == railgun){
-        int current_row = shooter_row + delta_row;
-        int current_col = shooter_col + delta_col;
-        
-        while (current_row >= 0 && current_row < arenaHeight &&
-               current_col >= 0 && current_col < arenaWidth){
-            affected_cells.push_back({current_row, current_col});
-            current_row += delta_row;
-            current_col += delta_col;
-        }
-    }
-    else if (weapon == flamethrower){
-        int side_row, side_col;
-        if (delta_row == 0){
-            side_row = 1;
-            side_col = 0;
-        }
-        else if (delta_col == 0){
-            side_row = 0;
-            side_col = 1;
-        }
-        else{  // Diagonal direction - perpendicular is (-delta_col, delta_row)
-            side_row = -delta_col;
-            side_col = delta_row;
-        }
-
-        int current_row = shooter_row;
-        int current_col = shooter_col;
-
-        for (int dist = 0; dist < 4; dist++){
-            current_row += delta_row;
-            current_col += delta_col;
-            
-            for (int offset = -1; offset <= 1; offset++){
-                int check_row = current_row + (side_row * offset);
-                int check_col = current_col + (side_col * offset);
-                
-                if (check_row >= 0 && check_row < arenaHeight &&
-                    check_col >= 0 && check_col < arenaWidth){
-                    affected_cells.push_back({check_row, check_col});
+        // The rail is the one-cell step for its direction repeated out to the edge. Only
+        // the cells with a robot in them are visited. A shot at the shooter's own cell
+        // has no direction and hits nothing.
+        if (direction != 0){
+            scan_ray(robot_lines, shooter_row, shooter_col, direction, true, [&](int, int current_row, int current_col){
+                if (hit_cell<Log>(index, weapon, current_row, current_col)){
+                    hit_something = true;
                 }
-            }
+            });
         }
     }
-    else if (weapon == hammer){
-        if (shot_row >= 0 && shot_row < arenaHeight &&
-            shot_col >= 0 && shot_col < arenaWidth){
+    else{
+        const ShotStencil* stencil = nullptr;
+        int anchor_row = shot_row;
+        int anchor_col = shot_col;
+
+        if (weapon == flamethrower){
+            stencil = &flame_stencils[direction];
+            anchor_row = shooter_row;
+            anchor_col = shooter_col;
+        }
+        else if (weapon == hammer){
             int row_diff = abs(shot_row - shooter_row);
             int col_diff = abs(shot_col - shooter_col);
             if (row_diff <= 1 && col_diff <= 1){
-                affected_cells.push_back({shot_row, shot_col});
+                stencil = &hammer_stencil;
             }
         }
-    }
-    else if (weapon == grenade){
-        if (robot->get_grenades() <= 0){
-            std::cout << robot->m_name << " is out of grenades!" << std::endl;
-            return;
-        }
-        robot->decrement_grenades();
-        
-        for (int r = shot_row - 1; r <= shot_row + 1; r++){
-            for (int c = shot_col - 1; c <= shot_col + 1; c++){
-                if (r >= 0 && r < arenaHeight && c >= 0 && c < arenaWidth){
-                    affected_cells.push_back({r, c});
+        else if (weapon == grenade){
+            if (robot->get_grenades() <= 0){
+                if constexpr (Log::enabled(log_shot)){
+                    log_event({record_no_grenades, {}, &robot->m_name});
                 }
+                return;
             }
+            uint64_t old_hash = robot_hash(index);
+            robot->decrement_grenades();
+            robots_hash ^= old_hash ^ robot_hash(index);
+            forget_states();
+            stencil = &grenade_stencil;
         }
-    }
-    
-    bool hit_something = false;
-    for (const auto& cell : affected_cells){
-        RobotBase* target = findRobotAt(cell.first, cell.second);
-        
-        if (target != nullptr && target != robot){
-            int damage = calculate_damage(weapon);
-            
-            int armor = target->get_armor();
-            damage = damage * (100 - armor * 10) / 100;
-            
-            target->take_damage(damage);
-            target->reduce_armor(1);
-            
-            std::cout << target->m_name << " takes " << damage 
-                      << " damage. Health: " << target->get_health() << std::endl;
-            
-            hit_something = true;
+
+        if (stencil != nullptr){
+            for (int i = 0; i < stencil->count; i++){
+                int row = anchor_row + stencil->cells[i].row;
+                int col = anchor_col + stencil->cells[i].col;
+                if (row < 0 || row >= arenaHeight || col < 0 || col >= arenaWidth){
+                    continue;
+                }
+                if (hit_cell<Log>(index, weapon, row, col)){
+                    hit_something = true;
+                }
+            }
         }
     }
     
     if (!hit_something){
-        std::cout << "Shot missed!" << std::endl;
+        if constexpr (Log::enabled(log_shot)){
+            log_event({record_missed});
+        }
     }
-}
\ No newline at end of file
+}
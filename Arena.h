@@ -1,50 +1,201 @@
 #pragma once
 #include <iostream>
 #include <vector>
+#include <cstdint>
 #include <string>
 #include <dlfcn.h>
 #include <filesystem>
 #include "RobotBase.h"
+#include "RadarScan.h"
+#include "Rng.h"
+#include "ArenaLog.h"
+#include "LogSink.h"
+#include "LiveView.h"
+#include "Minimap.h"
+#include "Replay.h"
+#include "StateHash.h"
+
+// How one robot did in a finished game.
+struct RobotResult {
+    std::string name;
+    int health;
+    int rounds_survived;
+    int damage_dealt;
+};
+
+struct MatchResult {
+    int rounds;
+    bool stalemate;  // ended early because the game was stuck; see stalemate_rounds, end_on_repeat
+    int winner;      // index into robots, -1 when every robot was destroyed
+    int living;      // robots still alive at the end
+    std::vector<RobotResult> robots;
+    std::vector<uint64_t> round_hashes;   // state hash at the start of each round played
+    uint64_t final_hash;                  // state hash when the game ended
+    uint64_t steady_allocations;          // arena allocations after the first round, alloc_check builds only
+};
+
+// Outcome of building one robot library. Messages and compiler output are collected
+// in log so builds running side by side can each be printed in one piece.
+struct RobotBuild {
+    std::string fileName;
+    std::string sharedLib;
+    std::string log;
+    bool ok = false;
+};
 
 class Arena {
+    friend class ArenaBench;   // bench.cpp times the private hot paths directly
+    friend class MatchBench;   // and plays whole matches with the rounds timed
+    friend class ArenaCheck;   // check.cpp compares scans and shots with reference versions
+
     protected:
     int arenaHeight;
     int arenaWidth;
-    std::vector<std::vector<char>> grid;
+    int gridStride;                // arenaWidth plus one padding column on each side
+    int bitStride;                 // 64-bit words per padded row in the bit-planes
+    std::vector<char> terrain;     // row-major, one padding cell around the arena
+    std::vector<uint64_t> terrain_bits;  // set wherever terrain is not empty
+    std::vector<uint64_t> robot_bits;    // set wherever occupancy is not empty
+    uint64_t terrain_hash = 0;           // StateHash keys of the terrain, kept up by set_terrain
+    uint64_t robots_hash = 0;            // StateHash keys of every robot, kept up as robots change
+    LinePlane radar_lines[4];            // terrain or robot present, indexed by LineFamily
+    LinePlane robot_lines[4];            // robot present, indexed by LineFamily
+    // Terrain hits of the scan from one cell in one direction, as a run in radar_cache_pool.
+    struct RadarCacheSlot {
+        uint32_t start;     // radar_cache_empty until the first scan from there
+        uint32_t count;
+    };
+    static const uint32_t radar_cache_empty = UINT32_MAX;
+    int radarCacheMB = 0;                // memory cap for the terrain radar cache, 0 turns it off
+    std::vector<RadarCacheSlot> radar_cache_slots;  // by cell * 9 + direction, made before the game
+    std::vector<RadarObj> radar_cache_pool;   // terrain hits of the scans cached so far, reserved to radarCacheMB
+    bool radar_cache_off = false;             // no terrain, or too many cells for radarCacheMB
+    std::vector<RadarObj> radar_overlay;      // robots found by the current cached scan
+    std::vector<RadarObj> radar_results;      // the current turn's scan, reused every turn
+    std::vector<int> occupancy;   // lowest robot index per cell, -1 when the cell is empty
+    std::vector<int> next_in_cell; // next robot index sharing the same cell, -1 ends the chain
     int mounds;
     int pits;
     int flamethrowers;
     int maxRound;
     int round;
     bool watch_live;
+    int watchFps = 30;          // live view frames per second
+    int watchRoundMs = 1000;    // live view time per round, unless fast-forwarding
+    int stalemateRounds = 0;    // end the game after this many rounds without damage, 0 never does
+    bool endOnRepeat = false;   // end the game when the state at the start of a round repeats
+    int last_damage_round = 0;
+    StateSet seen_states;       // state hashes since health, armor or grenades last changed
+    bool stalemate = false;
+    int stalemate_cause = 0;      // what ended it, for the game over message
+    bool headless = false;  // no board, event text or sleeping; run_game's result is the only output
     int maxRobots;
+    int compileJobs = 0;    // robots compiled at once, 0 means one per core
+    uint64_t seed = 0;
+    Rng map_rng;       // obstacle placement
+    Rng spawn_rng;     // robot start positions
+    Rng damage_rng;    // weapon and flamethrower damage
     std::vector<RobotBase*> robots;
     std::vector<void*> robot_handles;
     std::vector<char> robot_characters;
+    std::vector<int> damage_dealt;   // per robot, damage its shots have done
+    std::vector<int> death_round;    // per robot, round it was destroyed in, 0 while alive
+    // Each robot's location, health and armor, one array per field. RobotBase's getters
+    // live in RobotBase.cpp and can't be inlined here, so the arena reads these instead
+    // and updates them wherever it calls move_to, take_damage or reduce_armor.
+    std::vector<int> robot_row;
+    std::vector<int> robot_col;
+    std::vector<int> robot_health;
+    std::vector<int> robot_armor;
+    std::vector<uint8_t> robot_alive;
+    int living = 0;                  // robots with health left
+    std::vector<uint64_t> round_hashes;  // state_hash() at the start of every round of this game
+    uint64_t robot_allocations = 0;      // made inside robot code; counted in alloc_check builds only
+    uint64_t steady_allocations = 0;     // made by the arena after the first round, likewise
+    std::vector<uint64_t>* round_times = nullptr;  // when set, play_game adds each round's length in ns
+    std::ostream* out = &std::cout;
+    LogSink* log_sink = nullptr;    // when set, game output is written from the sink's thread
+    std::vector<uint16_t> display_cells;  // the board display() prints, reused every call
+    bool use_live_view = false;     // draw watch_live games on a terminal instead of as text
+    LiveView* live_view = nullptr;  // only set while such a game is running
+    Minimap minimap;                // live view of an arena too big for the terminal
+    ReplayWriter* replay = nullptr; // when set, run_game records the game into it
+    std::vector<ReplayRobot> replay_state;  // robot state for the replay's keyframes
 
     public:
     Arena();
     virtual ~Arena();
     void load_config(std::string fileName);
+    void set_seed(uint64_t seed);
     void place_obstacles();
     void display();
+    void set_output(std::ostream& stream);
+    void set_watch_live(bool live);
+    void set_headless(bool on);
+    void set_log_sink(LogSink* sink);
+    void set_live_view(bool on);
+    void set_replay(ReplayWriter* writer);
+    bool is_watch_live() const;
+    std::vector<RobotFactory> load_robot_factories();
     void load_all_robots();
+    void add_robot(RobotBase* robot);
     void cleanup();
-    void run_game();
+    MatchResult run_game();
+    void load_replay(const ReplayReader& reader);
+    void use_replay_settings(const ReplayReader& reader);
+    std::vector<std::string> robot_names() const;
+    void show_replay_state(const ReplayState& state);
 
     private:
+    void size_grid();
     bool cellEmpty(int& row, int& col);
     std::vector<std::string> find_robot_files();
     bool matches_robot_pattern(std::string fileName);
-    std::string compileRobot(const std::string& fileName);
-    RobotBase* loadRobot(const std::string& sharedLib);
-    void setupRobot(RobotBase* robot, int index);
+    RobotBuild compileRobot(const std::string& fileName);
+    RobotFactory loadFactory(const std::string& sharedLib);
+    void setupRobot(RobotBase* robot, int index, int& row, int& col);
     RobotBase* findRobotAt(int row, int col);
-    void process_robot_turn(RobotBase* robot);
-    void get_radar_results(RobotBase* robot, int direction, std::vector<RadarObj>& results);
-    void handle_shot(RobotBase* robot, int shot_row, int shot_col);
-    void handle_movement(RobotBase* robot, int direction, int distance);
+    int cell_index(int row, int col) const;
+    char terrain_at(int row, int col) const;
+    void set_terrain(int row, int col, char type);
+    bool cell_busy(int row, int col) const;
+    int radar_line(LineFamily family, int row, int col) const;
+    int radar_pos(LineFamily family, int row, int col) const;
+    void refresh_radar_cell(int row, int col);
+    void radar_check_cell(int scanner, int row, int col, std::vector<RadarObj>& results);
+    template <typename Visit>
+    void scan_ray(const LinePlane* planes, int row, int col, int direction, bool centre_only, Visit&& visit);
+    void clear_radar_cache();
+    void prepare_radar_cache();
+    RadarCacheSlot* radar_cache_slot(int row, int col, int direction);
+    void cache_radar_terrain(RadarCacheSlot& slot, const std::vector<RadarObj>& results);
+    int radar_order(int direction, int row, int col, const RadarObj& obj) const;
+    void place_robot(int index, int row, int col);
+    void remove_robot(int index, int row, int col);
+    void move_robot(int index, int new_row, int new_col);
+    void mirror_robot(RobotBase* robot, int row, int col);
+    void damage_robot(int index, int damage);
+    template <typename Log> MatchResult play_game();
+    template <typename Call> void robot_call(Call&& call);
+    template <typename Log> void process_robot_turn(int index);
+    void get_radar_results(int index, int direction, std::vector<RadarObj>& results);
+    template <typename Log> void handle_shot(int index, int shot_row, int shot_col);
+    template <typename Log> bool hit_cell(int shooter, WeaponType weapon, int row, int col);
+    template <typename Log> void handle_movement(int index, int direction, int distance);
     int count_living_robots();
+    uint64_t state_hash();
+    uint64_t robot_hash(int index);
+    void forget_states();
+    bool stalemate_reached();
+    MatchResult match_result();
     void declare_winner();
+    void log_event(const LogRecord& record);
+    void log_board();
+    void live_grid_size(int& rows, int& cols);
+    void start_minimap();
+    void window_cells(int first_row, int first_col, int rows, int cols, std::vector<uint16_t>& cells);
+    void publish_snapshot();
+    void fill_replay_robots();
+    void start_replay();
     int calculate_damage(WeaponType weapon);
 };
\ No newline at end of file
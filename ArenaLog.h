@@ -0,0 +1,39 @@
+#pragma once
+
+// Kinds of text the arena writes while a game is played.
+enum LogEvent {
+    log_game_over,   // the final result
+    log_turn,        // round banner, board and each robot's turn header
+    log_damage,      // damage taken from shots and flamethrowers
+    log_shot,        // weapon fired, misses, empty grenade launchers
+    log_movement,    // where robots moved and what stopped them
+    log_radar        // full radar results
+};
+
+// Events are enabled from the top of the list down, so level 1 only reports the
+// winner and level 6 reports everything.
+constexpr int log_event_level(LogEvent event){
+    return static_cast<int>(event) + 1;
+}
+
+// A log policy is picked when the game is compiled, not checked while it runs. The
+// turn code tests it with 'if constexpr', so a disabled event leaves no formatting
+// or stream calls behind.
+template <int Level>
+struct LogLevel {
+    static constexpr bool enabled(LogEvent event){
+        return log_event_level(event) <= Level;
+    }
+};
+
+// Set with 'make LOG_LEVEL=N'.
+#ifndef ROBOTWARZ_LOG_LEVEL
+#define ROBOTWARZ_LOG_LEVEL 6
+#endif
+
+using ArenaLog = LogLevel<ROBOTWARZ_LOG_LEVEL>;   // what a normal game prints
+using SilentLog = LogLevel<0>;                    // headless games
+using WatchLog = LogLevel<1>;                     // under the live board view, just the result
+
+static_assert(!SilentLog::enabled(log_game_over), "the silent policy prints nothing");
+static_assert(LogLevel<6>::enabled(log_radar), "level 6 prints every event");
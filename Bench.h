@@ -0,0 +1,64 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// Shared by bench.cpp, which runs the benchmarks, and BenchReport.cpp, which writes
+// their results out, reads saved baselines back and compares runs against them.
+
+struct BenchResult {
+    std::string name;
+    int arena = 0;
+    int robots = 0;
+    long ops = 0;                   // over all samples
+    std::vector<double> sample_ns;  // ns per op, one per sample
+    double allocs_per_op = 0;
+    // Match results only.
+    std::string mix;
+    long rounds = 0;                // per sample
+    std::vector<double> sample_rounds_per_sec;
+    std::vector<uint64_t> round_ns; // every round played, over all samples
+};
+
+struct BenchOptions {
+    std::string suite = "micro";
+    std::vector<int> sizes = {20, 64, 256, 1024, 4096};
+    std::vector<int> robot_counts = {3, 30, 300, 3000, 10000};
+    int samples = 5;
+    int min_ms = 20;
+    std::string only;
+    uint64_t seed = 1;
+    std::vector<int> match_sizes = {20, 64, 256};
+    std::vector<int> match_robots = {6, 30, 300};
+    std::vector<std::string> mixes = {"bundled", "stress", "mixed"};
+    std::vector<int> radar_cache_mbs = {0, 64};   // radarCacheMB for the matches
+    int matches = 4;    // per sample
+    int rounds = 200;   // max rounds per match
+};
+
+// Results files carry this number; a baseline with any other is refused, since its
+// samples may not mean the same thing.
+const int bench_format = 2;
+
+double median(std::vector<double> values);
+// Value at fraction of the way through the sorted values, nearest rank.
+uint64_t percentile(const std::vector<uint64_t>& sorted, double fraction);
+
+// The options and results as one JSON document.
+void write_results(std::ostream& out, const BenchOptions& options, const std::vector<BenchResult>& results);
+// Reads a document written by write_results. Returns false with a message in error if
+// the file can't be read or is from another format.
+bool read_results(const std::string& fileName, BenchOptions& options, std::vector<BenchResult>& results,
+                  std::string& error);
+
+// One sided Mann-Whitney U test: the chance of current's samples coming out at least
+// this much bigger than baseline's if both came from the same distribution. Exact for
+// small samples without ties, normal approximation otherwise.
+double mann_whitney_p(const std::vector<double>& baseline, const std::vector<double>& current);
+
+// Pairs up the benchmarks run in both and prints how each moved. A benchmark has
+// regressed when its median is more than threshold (a fraction) slower and the test
+// gives p below alpha. Returns how many regressed.
+int compare_results(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& current,
+                    double threshold, double alpha, std::ostream& out);
@@ -0,0 +1,450 @@
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+#include "Bench.h"
+
+double median(std::vector<double> values){
+    if (values.empty()){
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
+
+uint64_t percentile(const std::vector<uint64_t>& sorted, double fraction){
+    if (sorted.empty()){
+        return 0;
+    }
+    size_t rank = static_cast<size_t>(fraction * sorted.size() + 0.999999);
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+static void write_string(std::ostream& out, const std::string& text){
+    out << '"';
+    for (char c : text){
+        if (c == '"' || c == '\\'){
+            out << '\\';
+        }
+        out << c;
+    }
+    out << '"';
+}
+
+template <typename T>
+static void write_list(std::ostream& out, const std::vector<T>& values){
+    out << "[";
+    for (size_t i = 0; i < values.size(); i++){
+        out << (i == 0 ? "" : ", ");
+        if constexpr (std::is_same_v<T, std::string>){
+            write_string(out, values[i]);
+        }
+        else{
+            out << values[i];
+        }
+    }
+    out << "]";
+}
+
+void write_results(std::ostream& out, const BenchOptions& options, const std::vector<BenchResult>& results){
+    char number[64];
+    const char* suite = options.suite == "all" ? "arena" : options.suite == "matches" ? "arena_matches" : "arena_micro";
+    out << "{\n  \"suite\": \"" << suite << "\",\n  \"format\": " << bench_format << ",\n";
+    out << "  \"seed\": " << options.seed << ",\n  \"samples\": " << options.samples
+        << ",\n  \"min_ms\": " << options.min_ms << ",\n";
+    // Everything needed to run the same benchmarks again when comparing.
+    out << "  \"options\": {\"suite\": ";
+    write_string(out, options.suite);
+    out << ", \"sizes\": ";
+    write_list(out, options.sizes);
+    out << ", \"robots\": ";
+    write_list(out, options.robot_counts);
+    out << ", \"only\": ";
+    write_string(out, options.only);
+    out << ", \"match_sizes\": ";
+    write_list(out, options.match_sizes);
+    out << ", \"match_robots\": ";
+    write_list(out, options.match_robots);
+    out << ", \"mixes\": ";
+    write_list(out, options.mixes);
+    out << ", \"radar_cache_mb\": ";
+    write_list(out, options.radar_cache_mbs);
+    out << ", \"matches\": " << options.matches << ", \"rounds\": " << options.rounds << "},\n";
+    out << "  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++){
+        const BenchResult& result = results[i];
+        double ns = median(result.sample_ns);
+        out << (i == 0 ? "\n" : ",\n");
+        out << "    {\"name\": \"" << result.name << "\", \"arena\": " << result.arena
+            << ", \"robots\": " << result.robots << ", \"ops\": " << result.ops;
+        snprintf(number, sizeof(number), "%.3f", ns);
+        out << ", \"ns_per_op\": " << number;
+        snprintf(number, sizeof(number), "%.3f", result.allocs_per_op);
+        out << ", \"allocs_per_op\": " << number;
+        snprintf(number, sizeof(number), "%.1f", ns > 0 ? 1e9 / ns : 0);
+        out << ", \"ops_per_sec\": " << number;
+        // For matches an op is one match; round latency is over every round played.
+        if (!result.mix.empty()){
+            out << ", \"mix\": \"" << result.mix << "\", \"rounds\": " << result.rounds;
+            snprintf(number, sizeof(number), "%.1f", median(result.sample_rounds_per_sec));
+            out << ", \"rounds_per_sec\": " << number;
+            out << ", \"p50_round_ns\": " << percentile(result.round_ns, 0.50)
+                << ", \"p99_round_ns\": " << percentile(result.round_ns, 0.99);
+        }
+        out << ", \"samples_ns\": [";
+        for (size_t s = 0; s < result.sample_ns.size(); s++){
+            snprintf(number, sizeof(number), "%.3f", result.sample_ns[s]);
+            out << (s == 0 ? "" : ", ") << number;
+        }
+        out << "]}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+// Just enough JSON to read back what write_results wrote.
+struct JsonValue {
+    enum Kind { null_value, boolean, number, string, array, object };
+    Kind kind = null_value;
+    double value = 0;
+    std::string text;
+    std::vector<JsonValue> items;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    const JsonValue* get(const std::string& key) const{
+        for (const auto& member : members){
+            if (member.first == key){
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+    public:
+    JsonParser(const std::string& text) : at(text.data()), end(text.data() + text.size()){}
+
+    bool parse(JsonValue& value){
+        bool ok = parse_value(value);
+        skip_space();
+        return ok && at == end;
+    }
+
+    private:
+    const char* at;
+    const char* end;
+
+    void skip_space(){
+        while (at < end && (*at == ' ' || *at == '\n' || *at == '\r' || *at == '\t')){
+            at++;
+        }
+    }
+
+    bool take(char c){
+        skip_space();
+        if (at < end && *at == c){
+            at++;
+            return true;
+        }
+        return false;
+    }
+
+    bool take_word(const char* word){
+        size_t length = std::char_traits<char>::length(word);
+        if (static_cast<size_t>(end - at) >= length && std::equal(word, word + length, at)){
+            at += length;
+            return true;
+        }
+        return false;
+    }
+
+    bool parse_string(std::string& text){
+        if (!take('"')){
+            return false;
+        }
+        while (at < end && *at != '"'){
+            if (*at == '\\'){
+                if (++at >= end){
+                    return false;
+                }
+            }
+            text += *at++;
+        }
+        return at++ < end;
+    }
+
+    bool parse_value(JsonValue& value){
+        skip_space();
+        if (at >= end){
+            return false;
+        }
+        if (*at == '{'){
+            at++;
+            value.kind = JsonValue::object;
+            if (take('}')){
+                return true;
+            }
+            do{
+                std::pair<std::string, JsonValue> member;
+                if (!parse_string(member.first) || !take(':') || !parse_value(member.second)){
+                    return false;
+                }
+                value.members.push_back(std::move(member));
+            } while (take(','));
+            return take('}');
+        }
+        if (*at == '['){
+            at++;
+            value.kind = JsonValue::array;
+            if (take(']')){
+                return true;
+            }
+            do{
+                value.items.emplace_back();
+                if (!parse_value(value.items.back())){
+                    return false;
+                }
+            } while (take(','));
+            return take(']');
+        }
+        if (*at == '"'){
+            value.kind = JsonValue::string;
+            return parse_string(value.text);
+        }
+        if (take_word("true") || take_word("false")){
+            value.kind = JsonValue::boolean;
+            value.value = at[-2] == 'u';
+            return true;
+        }
+        if (take_word("null")){
+            return true;
+        }
+        char* number_end;
+        std::string rest(at, std::min<size_t>(end - at, 64));
+        value.value = std::strtod(rest.c_str(), &number_end);
+        if (number_end == rest.c_str()){
+            return false;
+        }
+        value.kind = JsonValue::number;
+        at += number_end - rest.c_str();
+        return true;
+    }
+};
+
+static double number_at(const JsonValue& object, const std::string& key, double fallback){
+    const JsonValue* value = object.get(key);
+    return value != nullptr && value->kind == JsonValue::number ? value->value : fallback;
+}
+
+static std::string string_at(const JsonValue& object, const std::string& key){
+    const JsonValue* value = object.get(key);
+    return value != nullptr && value->kind == JsonValue::string ? value->text : "";
+}
+
+static std::vector<int> ints_at(const JsonValue& object, const std::string& key, const std::vector<int>& fallback){
+    const JsonValue* value = object.get(key);
+    if (value == nullptr || value->kind != JsonValue::array){
+        return fallback;
+    }
+    std::vector<int> values;
+    for (const JsonValue& item : value->items){
+        values.push_back(static_cast<int>(item.value));
+    }
+    return values;
+}
+
+bool read_results(const std::string& fileName, BenchOptions& options, std::vector<BenchResult>& results,
+                  std::string& error){
+    std::ifstream file(fileName);
+    if (!file){
+        error = "could not open " + fileName;
+        return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string text = contents.str();
+    JsonValue document;
+    JsonParser parser(text);
+    if (!parser.parse(document) || document.kind != JsonValue::object){
+        error = fileName + " is not a benchmark results file";
+        return false;
+    }
+    int format = static_cast<int>(number_at(document, "format", 0));
+    if (format != bench_format){
+        error = fileName + " is in results format " + std::to_string(format) + ", this build writes "
+                + std::to_string(bench_format) + "; save a new baseline with --save";
+        return false;
+    }
+
+    options.seed = static_cast<uint64_t>(number_at(document, "seed", options.seed));
+    options.samples = static_cast<int>(number_at(document, "samples", options.samples));
+    options.min_ms = static_cast<int>(number_at(document, "min_ms", options.min_ms));
+    if (const JsonValue* saved = document.get("options")){
+        options.suite = string_at(*saved, "suite");
+        options.sizes = ints_at(*saved, "sizes", options.sizes);
+        options.robot_counts = ints_at(*saved, "robots", options.robot_counts);
+        options.only = string_at(*saved, "only");
+        options.match_sizes = ints_at(*saved, "match_sizes", options.match_sizes);
+        options.match_robots = ints_at(*saved, "match_robots", options.match_robots);
+        if (const JsonValue* mixes = saved->get("mixes")){
+            options.mixes.clear();
+            for (const JsonValue& mix : mixes->items){
+                options.mixes.push_back(mix.text);
+            }
+        }
+        options.matches = static_cast<int>(number_at(*saved, "matches", options.matches));
+        options.rounds = static_cast<int>(number_at(*saved, "rounds", options.rounds));
+        options.radar_cache_mbs = ints_at(*saved, "radar_cache_mb", options.radar_cache_mbs);
+    }
+
+    const JsonValue* saved_results = document.get("results");
+    if (saved_results == nullptr || saved_results->kind != JsonValue::array){
+        error = fileName + " has no results";
+        return false;
+    }
+    for (const JsonValue& saved : saved_results->items){
+        BenchResult result;
+        result.name = string_at(saved, "name");
+        result.arena = static_cast<int>(number_at(saved, "arena", 0));
+        result.robots = static_cast<int>(number_at(saved, "robots", 0));
+        result.ops = static_cast<long>(number_at(saved, "ops", 0));
+        result.allocs_per_op = number_at(saved, "allocs_per_op", 0);
+        result.mix = string_at(saved, "mix");
+        result.rounds = static_cast<long>(number_at(saved, "rounds", 0));
+        if (const JsonValue* samples = saved.get("samples_ns")){
+            for (const JsonValue& sample : samples->items){
+                result.sample_ns.push_back(sample.value);
+            }
+        }
+        results.push_back(std::move(result));
+    }
+    return true;
+}
+
+double mann_whitney_p(const std::vector<double>& baseline, const std::vector<double>& current){
+    size_t m = baseline.size();
+    size_t n = current.size();
+    if (m == 0 || n == 0){
+        return 1;
+    }
+
+    // U counts the pairs where the current sample is the bigger one, ties as halves.
+    double u = 0;
+    bool ties = false;
+    for (double b : baseline){
+        for (double c : current){
+            u += c > b ? 1 : c == b ? 0.5 : 0;
+            ties = ties || c == b;
+        }
+    }
+
+    if (!ties && m + n <= 40){
+        // ways[i][j][k]: orderings of i current and j baseline samples with U = k.
+        // The biggest sample is either a current one, beating all j baseline ones, or not.
+        std::vector<std::vector<std::vector<double>>> ways(n + 1, std::vector<std::vector<double>>(m + 1));
+        for (size_t i = 0; i <= n; i++){
+            for (size_t j = 0; j <= m; j++){
+                std::vector<double>& counts = ways[i][j];
+                counts.assign(i * j + 1, 0);
+                if (i == 0 || j == 0){
+                    counts[0] = 1;
+                    continue;
+                }
+                for (size_t k = 0; k < counts.size(); k++){
+                    if (k >= j && k - j < ways[i - 1][j].size()){
+                        counts[k] += ways[i - 1][j][k - j];
+                    }
+                    if (k < ways[i][j - 1].size()){
+                        counts[k] += ways[i][j - 1][k];
+                    }
+                }
+            }
+        }
+        const std::vector<double>& counts = ways[n][m];
+        double total = 0;
+        double at_least = 0;
+        for (size_t k = 0; k < counts.size(); k++){
+            total += counts[k];
+            if (static_cast<double>(k) >= u){
+                at_least += counts[k];
+            }
+        }
+        return at_least / total;
+    }
+
+    // Normal approximation, with the variance corrected for ties.
+    std::vector<double> all = baseline;
+    all.insert(all.end(), current.begin(), current.end());
+    std::sort(all.begin(), all.end());
+    double tie_sum = 0;
+    for (size_t i = 0; i < all.size();){
+        size_t j = i;
+        while (j < all.size() && all[j] == all[i]){
+            j++;
+        }
+        double t = static_cast<double>(j - i);
+        tie_sum += t * t * t - t;
+        i = j;
+    }
+    double total = static_cast<double>(m + n);
+    double mean = static_cast<double>(m * n) / 2;
+    double variance = static_cast<double>(m * n) / 12 * ((total + 1) - tie_sum / (total * (total - 1)));
+    if (variance <= 0){
+        return 1;
+    }
+    double z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+int compare_results(const std::vector<BenchResult>& baseline, const std::vector<BenchResult>& current,
+                    double threshold, double alpha, std::ostream& out){
+    char line[256];
+    int regressed = 0;
+    int compared = 0;
+    // Match names run long, so the name column is as wide as the longest one.
+    int width = std::strlen("Benchmark");
+    for (const BenchResult& now : current){
+        width = std::max(width, static_cast<int>(now.name.size()));
+    }
+    snprintf(line, sizeof(line), "%-*s %6s %6s %14s %14s %8s %7s\n",
+             width, "Benchmark", "Arena", "Robots", "Baseline ns", "Current ns", "Change", "p");
+    out << line;
+    for (const BenchResult& now : current){
+        auto before = std::find_if(baseline.begin(), baseline.end(), [&](const BenchResult& saved){
+            return saved.name == now.name && saved.arena == now.arena && saved.robots == now.robots;
+        });
+        double now_ns = median(now.sample_ns);
+        if (before == baseline.end()){
+            snprintf(line, sizeof(line), "%-*s %6d %6d %14s %14.1f %8s %7s  new\n",
+                     width, now.name.c_str(), now.arena, now.robots, "-", now_ns, "-", "-");
+            out << line;
+            continue;
+        }
+        compared++;
+        double before_ns = median(before->sample_ns);
+        double change = before_ns > 0 ? now_ns / before_ns - 1 : 0;
+        double slower_p = mann_whitney_p(before->sample_ns, now.sample_ns);
+        double faster_p = mann_whitney_p(now.sample_ns, before->sample_ns);
+        const char* verdict = "";
+        double p = std::min(slower_p, faster_p);
+        if (change > threshold && slower_p < alpha){
+            verdict = "  REGRESSED";
+            regressed++;
+        }
+        else if (change < -threshold && faster_p < alpha){
+            verdict = "  faster";
+        }
+        snprintf(line, sizeof(line), "%-*s %6d %6d %14.1f %14.1f %+7.1f%% %7.3f%s\n",
+                 width, now.name.c_str(), now.arena, now.robots, before_ns, now_ns, 100 * change, p, verdict);
+        out << line;
+    }
+    snprintf(line, sizeof(line), "\n%d of %d benchmarks regressed (more than %.0f%% slower, p < %.3g)\n",
+             regressed, compared, 100 * threshold, alpha);
+    out << line;
+    return regressed;
+}
@@ -0,0 +1,179 @@
+#include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <csignal>
+#include <cstdlib>
+#include <algorithm>
+#include "LiveView.h"
+
+// The terminal settings from before raw mode. finish() puts them back, but so do exit()
+// and the signals that end the program, Ctrl-C or a robot crashing included, so the
+// shell never comes back without echo. tcsetattr is safe to call from a handler.
+static termios saved_terminal;
+static volatile sig_atomic_t terminal_raw = 0;
+
+static void restore_terminal(){
+    if (terminal_raw){
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved_terminal);
+        terminal_raw = 0;
+    }
+}
+
+// Installed with SA_RESETHAND, so the signal raised again once this returns does
+// whatever it would have done without the live view.
+static void restore_terminal_on_signal(int signal){
+    restore_terminal();
+    raise(signal);
+}
+
+static void install_terminal_restore(){
+    static bool installed = false;
+    if (installed){
+        return;
+    }
+    installed = true;
+    std::atexit(restore_terminal);
+    for (int signal : {SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGABRT, SIGFPE, SIGSEGV, SIGBUS, SIGILL}){
+        struct sigaction current;
+        // Leave alone any handler the program has set up itself.
+        if (sigaction(signal, nullptr, &current) != 0 || current.sa_handler != SIG_DFL){
+            continue;
+        }
+        struct sigaction action = {};
+        action.sa_handler = restore_terminal_on_signal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESETHAND;
+        sigaction(signal, &action, nullptr);
+    }
+}
+
+LiveView::LiveView(int fps, int round_ms)
+    : frame_time(1000 / std::max(1, fps)), round_time(std::max(0, round_ms)){
+    next_round = std::chrono::steady_clock::now();
+
+    winsize size;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0){
+        screenRows = size.ws_row;
+        screenCols = size.ws_col;
+    }
+
+    // Read single key presses without waiting for enter or echoing them.
+    if (isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &saved_terminal) == 0){
+        install_terminal_restore();
+        termios raw = saved_terminal;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        keyboard = tcsetattr(STDIN_FILENO, TCSANOW, &raw) == 0;
+        terminal_raw = keyboard;
+    }
+
+    render_thread = std::thread(&LiveView::render_loop, this);
+}
+
+LiveView::~LiveView(){
+    finish();
+}
+
+// Swaps the finished back snapshot into the middle and takes the old middle to fill next.
+void LiveView::publish(){
+    back = middle.exchange(back | fresh, std::memory_order_acq_rel) & 3;
+}
+
+// Swaps the front snapshot for the middle one, if the game has published since last time.
+bool LiveView::take_latest(){
+    if ((middle.load(std::memory_order_acquire) & fresh) == 0){
+        return false;
+    }
+    front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+    return true;
+}
+
+void LiveView::pace_round(){
+    // Pausing is the viewer's choice; the renderer itself never holds the game up.
+    bool was_paused = false;
+    while (paused.load(std::memory_order_acquire)){
+        was_paused = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (fast_forward.load(std::memory_order_acquire) || was_paused){
+        next_round = now;
+        return;
+    }
+
+    // Rounds start on a fixed clock, so the time spent playing one isn't added on top.
+    next_round += round_time;
+    if (next_round < now){
+        next_round = now;
+        return;
+    }
+    std::this_thread::sleep_until(next_round);
+}
+
+void LiveView::draw_front(){
+    const ArenaSnapshot& snapshot = snapshots[front];
+    if (snapshot.rows == 0){
+        return;
+    }
+
+    std::string mode = paused ? "[paused] " : fast_forward ? "[fast-forward] " : "";
+    renderer.draw(snapshot, mode + "space: pause  f: fast-forward  n: follow next robot");
+}
+
+// Handles each key waiting on stdin.
+void LiveView::read_keys(){
+    char keys[16];
+    ssize_t count = read(STDIN_FILENO, keys, sizeof(keys));
+    for (ssize_t i = 0; i < count; i++){
+        if (keys[i] == ' '){
+            paused = !paused;
+        }
+        else if (keys[i] == 'f' || keys[i] == 'F'){
+            fast_forward = !fast_forward;
+        }
+        else if (keys[i] == 'n' || keys[i] == 'N'){
+            int robots = snapshots[front].status.size();
+            int next = follow + 1;
+            follow = next < robots ? next : -1;
+        }
+    }
+}
+
+void LiveView::render_loop(){
+    while (!stopping.load(std::memory_order_acquire)){
+        bool key_pressed = false;
+        if (keyboard){
+            pollfd input = {STDIN_FILENO, POLLIN, 0};
+            if (poll(&input, 1, frame_time.count()) > 0){
+                read_keys();
+                key_pressed = true;
+            }
+        }
+        else{
+            std::this_thread::sleep_for(frame_time);
+        }
+
+        // A key press redraws the status line even if the game hasn't moved on.
+        if (take_latest() || key_pressed){
+            draw_front();
+        }
+    }
+}
+
+void LiveView::finish(){
+    if (finished){
+        return;
+    }
+    finished = true;
+
+    stopping.store(true, std::memory_order_release);
+    render_thread.join();
+    take_latest();
+    draw_front();
+    renderer.finish();
+
+    restore_terminal();
+}
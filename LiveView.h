@@ -0,0 +1,79 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "TerminalRenderer.h"
+
+// Draws a running game on its own thread. The game fills the back snapshot and
+// publishes it each round; the render thread wakes up fps times a second and draws
+// the newest snapshot, skipping any it missed. Three snapshots rotate so neither side
+// ever waits for the other.
+//
+// Keys: space pauses and resumes, f toggles fast-forward (no pause between rounds),
+// n follows the next robot with a full size window, and after the last robot goes
+// back to the overview.
+class LiveView {
+    public:
+    LiveView(int fps, int round_ms);
+    ~LiveView();
+    LiveView(const LiveView&) = delete;
+    LiveView& operator=(const LiveView&) = delete;
+
+    // Only the game thread may touch the back snapshot.
+    ArenaSnapshot& back_snapshot(){
+        return snapshots[back];
+    }
+    void publish();
+
+    // Called by the game between rounds. Waits out the rest of the round's time slot,
+    // or while the viewer has paused; returns straight away in fast-forward.
+    void pace_round();
+
+    // Robot the viewer wants to follow, or -1 for the whole arena.
+    int followed_robot() const{
+        return follow.load(std::memory_order_relaxed);
+    }
+
+    // Terminal size when the view started.
+    int screen_rows() const{
+        return screenRows;
+    }
+    int screen_cols() const{
+        return screenCols;
+    }
+
+    // Draws the last published snapshot, stops the render thread and leaves the cursor
+    // under the board.
+    void finish();
+
+    private:
+    static const int fresh = 4;
+
+    ArenaSnapshot snapshots[3];
+    int back = 0;                      // game thread
+    int front = 2;                     // render thread
+    std::atomic<int> middle{1};        // index, plus 'fresh' once the game publishes
+    std::atomic<bool> paused{false};
+    std::atomic<bool> fast_forward{false};
+    std::atomic<bool> stopping{false};
+    std::atomic<int> follow{-1};
+    int screenRows = 24;
+    int screenCols = 80;
+
+    std::chrono::milliseconds frame_time;
+    std::chrono::milliseconds round_time;
+    std::chrono::steady_clock::time_point next_round;
+
+    TerminalRenderer renderer;
+    bool keyboard = false;    // stdin is in raw mode for key presses; see LiveView.cpp
+    std::thread render_thread;
+    bool finished = false;
+
+    bool take_latest();
+    void draw_front();
+    void read_keys();
+    void render_loop();
+};
@@ -0,0 +1,218 @@
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include "LogSink.h"
+#include "TerminalRenderer.h"
+
+void write_log_record(std::ostream& stream, const LogRecord& record){
+    const int32_t* v = record.values;
+    switch (record.kind){
+        case record_board:
+            break;
+        case record_round:
+            stream << "=========== starting round " << v[0] << " ===========\n";
+            break;
+        case record_out:
+            stream << *record.name << " is out.\n";
+            break;
+        case record_turn:
+            stream << *record.name << " begins turn. \n";
+            stream << "Current health: " << v[0] << "\n";
+            stream << "Current armor: " << v[1] << "\n";
+            stream << "Current move speed: " << v[2] << "\n";
+            stream << "Current location: (" << v[3] << "," << v[4] << ")\n";
+            break;
+        case record_found_nothing:
+            stream << "Found nothing.\n";
+            break;
+        case record_radar_header:
+            stream << "Radar results:\n";
+            break;
+        case record_radar_hit:
+            stream << "  - Found '" << static_cast<char>(v[0])
+                   << "' at (" << v[1] << "," << v[2] << ")\n";
+            break;
+        case record_shooting:
+            stream << "Shooting: " << v[0] << "\n";
+            break;
+        case record_moving:
+            stream << "Moving: " << *record.name << "\n";
+            break;
+        case record_stays:
+            stream << *record.name << " stays in place.\n";
+            break;
+        case record_blocked_mound:
+            stream << *record.name << " blocked by mound.\n";
+            break;
+        case record_fell_in_pit:
+            stream << *record.name << " fell into a pit!\n";
+            break;
+        case record_flame_damage:
+            stream << *record.name << " hit by flamethrower! Takes " << v[0] << " damage.\n";
+            break;
+        case record_blocked_robot:
+            stream << *record.name << " blocked by " << *record.other << ".\n";
+            break;
+        case record_moved:
+            stream << *record.name << " moves to (" << v[0] << "," << v[1] << ")\n";
+            break;
+        case record_damage:
+            stream << *record.name << " takes " << v[0] << " damage. Health: " << v[1] << "\n";
+            break;
+        case record_no_grenades:
+            stream << *record.name << " is out of grenades!\n";
+            break;
+        case record_missed:
+            stream << "Shot missed!\n";
+            break;
+        case record_stalemate:
+            if (v[0] > 0){
+                stream << "\nStalemate: no damage for " << v[0] << " rounds\n";
+            }
+            else{
+                stream << "\nStalemate: the arena is back in a state it was in before\n";
+            }
+            break;
+        case record_game_over:
+            stream << "\n========== GAME OVER ==========\n";
+            if (v[0] == 0){
+                stream << "Draw - all robots destroyed!\n";
+            }
+            else if (v[0] == 1){
+                stream << *record.name << " wins!\n";
+            }
+            else{
+                // Multiple robots alive (max rounds reached)
+                stream << *record.name << " wins with " << v[1] << " health remaining!\n";
+            }
+            break;
+    }
+}
+
+void write_board(std::ostream& stream, int rows, int cols, const uint16_t* cells){
+    // Print column headers
+    stream << "   ";
+    for (int column = 0; column < cols; column++){
+        stream << std::setw(3) << std::right << column;
+    }
+    stream << "\n";
+    stream << std::endl;
+
+    for (int row = 0; row < rows; row++){
+        stream << std::setw(2) << std::right << row;
+        stream << "  ";
+        for (int col = 0; col < cols; col++){
+            uint16_t cell = cells[row * cols + col];
+            char character = static_cast<char>(cell & 0xff);
+            switch (cell & 0xff00){
+                case cell_robot:
+                    stream << " R" << character;
+                    break;
+                case cell_dead_robot:
+                    stream << " X" << character;
+                    break;
+                default:
+                    stream << std::setw(3) << std::right << character;
+                    break;
+            }
+        }
+        stream << "\n";
+    }
+}
+
+LogSink::LogSink(std::ostream& stream, Overflow overflow, size_t capacity)
+    : out(&stream), overflow(overflow){
+    size_t size = 2;
+    while (size < capacity){
+        size *= 2;
+    }
+    slots.resize(size);
+    mask = size - 1;
+    board_busy = std::make_unique<std::atomic<bool>[]>(board_slots);
+    writer = std::thread(&LogSink::write_loop, this);
+}
+
+LogSink::~LogSink(){
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+}
+
+void LogSink::post(const LogRecord& record){
+    size_t position = head.load(std::memory_order_relaxed);
+    while (position - tail.load(std::memory_order_acquire) > mask){
+        if (overflow == overflow_drop){
+            if (record.kind == record_board){
+                board_busy[record.values[2]].store(false, std::memory_order_release);
+            }
+            dropped_records++;
+            return;
+        }
+        std::this_thread::yield();
+    }
+    slots[position & mask] = record;
+    head.store(position + 1, std::memory_order_release);
+}
+
+void LogSink::reserve_boards(size_t cells){
+    flush();
+    for (auto& slot : boards){
+        slot.resize(std::max(slot.size(), cells));
+    }
+}
+
+int LogSink::claim_board(){
+    int slot = next_board;
+    while (board_busy[slot].load(std::memory_order_acquire)){
+        if (overflow == overflow_drop){
+            dropped_records++;
+            return -1;
+        }
+        std::this_thread::yield();
+    }
+    board_busy[slot].store(true, std::memory_order_relaxed);
+    next_board = (next_board + 1) % board_slots;
+    return slot;
+}
+
+void LogSink::flush(){
+    size_t posted = head.load(std::memory_order_relaxed);
+    while (written.load(std::memory_order_acquire) < posted){
+        std::this_thread::yield();
+    }
+}
+
+// Formats whatever has piled up since the last pass and writes it in one go.
+void LogSink::write_loop(){
+    std::ostringstream batch;
+    while (true){
+        size_t position = tail.load(std::memory_order_relaxed);
+        size_t end = head.load(std::memory_order_acquire);
+        if (position == end){
+            if (stopping.load(std::memory_order_acquire) && head.load(std::memory_order_acquire) == end){
+                return;
+            }
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+
+        batch.str("");
+        for (; position != end; position++){
+            const LogRecord& record = slots[position & mask];
+            if (record.kind == record_board){
+                int slot = record.values[2];
+                write_board(batch, record.values[0], record.values[1], boards[slot].data());
+                board_busy[slot].store(false, std::memory_order_release);
+            }
+            else{
+                write_log_record(batch, record);
+            }
+        }
+        tail.store(end, std::memory_order_release);
+
+        std::string text = batch.str();
+        out->write(text.data(), text.size());
+        out->flush();
+        written.store(end, std::memory_order_release);
+    }
+}
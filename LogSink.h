@@ -0,0 +1,106 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <thread>
+#include <memory>
+
+// One line (or block) of game output, kept as the raw values it is made from.
+// Turning it into text is left to whoever writes it out.
+enum LogRecordKind : uint8_t {
+    record_board,           // rows, cols, slot; the cells are in the sink's board slot
+    record_round,           // values[0] = round
+    record_out,             // name is out
+    record_turn,            // health, armor, move speed, row, col
+    record_found_nothing,
+    record_radar_header,
+    record_radar_hit,       // type, row, col
+    record_shooting,        // weapon
+    record_moving,
+    record_stays,
+    record_blocked_mound,
+    record_fell_in_pit,
+    record_flame_damage,    // damage
+    record_blocked_robot,   // other is the robot in the way
+    record_moved,           // row, col
+    record_damage,          // damage, health
+    record_no_grenades,
+    record_missed,
+    record_stalemate,       // values[0] = rounds without damage, 0 when the state repeated
+    record_game_over,       // values[0] = robots left, values[1] = winner's health
+};
+
+struct LogRecord {
+    LogRecordKind kind = record_round;
+    int32_t values[5] = {};
+    const std::string* name = nullptr;    // robot the event is about
+    const std::string* other = nullptr;
+};
+
+// Writes one record exactly as the arena has always printed it. A record_board
+// record needs its cells, so only LogSink can write those.
+void write_log_record(std::ostream& stream, const LogRecord& record);
+
+// Writes the board the way Arena::display() shows it, from rows * cols cell codes
+// (see CellKind in TerminalRenderer.h).
+void write_board(std::ostream& stream, int rows, int cols, const uint16_t* cells);
+
+// Takes records from the game thread and writes them from a background thread, so the
+// game never waits on a slow terminal or pipe. The queue is a single producer, single
+// consumer ring: only one thread may post, and names passed in records must stay alive
+// until flush() returns.
+class LogSink {
+    public:
+    enum Overflow { overflow_block, overflow_drop };
+
+    LogSink(std::ostream& stream, Overflow overflow = overflow_block, size_t capacity = 1 << 16);
+    ~LogSink();
+    LogSink(const LogSink&) = delete;
+    LogSink& operator=(const LogSink&) = delete;
+
+    // When the ring is full, either waits for room or throws the record away,
+    // depending on the overflow policy.
+    void post(const LogRecord& record);
+
+    // Boards are posted as cell codes in one of a few slots, and the writer thread
+    // turns them into text. reserve_boards sizes every slot before a game so posting
+    // a board allocates nothing; it waits for anything already posted to be written.
+    void reserve_boards(size_t cells);
+    // A slot to fill and post in a record_board record. Waits for the oldest slot to
+    // be written, or returns -1 when it hasn't been and the policy is to drop.
+    int claim_board();
+    std::vector<uint16_t>& board(int slot){
+        return boards[slot];
+    }
+
+    // Waits until everything posted so far has been written.
+    void flush();
+
+    size_t dropped() const{
+        return dropped_records;
+    }
+
+    private:
+    std::ostream* out;
+    Overflow overflow;
+    std::vector<LogRecord> slots;
+    size_t mask;
+    size_t dropped_records = 0;
+    static const int board_slots = 4;
+    std::vector<uint16_t> boards[board_slots];
+    std::unique_ptr<std::atomic<bool>[]> board_busy;   // claimed and not yet written
+    int next_board = 0;
+
+    // Positions only ever grow; a slot is position & mask. Each one gets its own cache
+    // line so the two threads don't fight over them.
+    alignas(64) std::atomic<size_t> head{0};       // next slot the producer fills
+    alignas(64) std::atomic<size_t> tail{0};       // next slot the consumer reads
+    alignas(64) std::atomic<size_t> written{0};    // records already on the stream
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+
+    void write_loop();
+};
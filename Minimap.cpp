@@ -0,0 +1,65 @@
+#include <algorithm>
+#include "Minimap.h"
+#include "TerminalRenderer.h"
+
+void Minimap::reset(int arena_rows, int arena_cols, int block_rows, int block_cols){
+    arenaRows = arena_rows;
+    arenaCols = arena_cols;
+    blockRows = std::max(1, block_rows);
+    blockCols = std::max(1, block_cols);
+    gridRows = (arenaRows + blockRows - 1) / blockRows;
+    gridCols = (arenaCols + blockCols - 1) / blockCols;
+
+    size_t blocks = static_cast<size_t>(gridRows) * gridCols;
+    live.assign(blocks, 0);
+    live_index_sum.assign(blocks, 0);
+    dead.assign(blocks, 0);
+    terrain.assign(blocks, 0);
+}
+
+void Minimap::add_terrain(int row, int col){
+    terrain[block(row, col)]++;
+}
+
+void Minimap::add_robot(int row, int col, int index, bool alive, int delta){
+    int at = block(row, col);
+    if (alive){
+        live[at] += delta;
+        live_index_sum[at] += delta * index;
+    }
+    else{
+        dead[at] += delta;
+    }
+}
+
+void Minimap::glyphs(const std::vector<char>& characters, std::vector<uint16_t>& cells) const{
+    cells.resize(static_cast<size_t>(gridRows) * gridCols);
+    for (int grid_row = 0; grid_row < gridRows; grid_row++){
+        // Blocks on the bottom and right edges can be cut short by the arena.
+        int height = std::min(blockRows, arenaRows - grid_row * blockRows);
+        for (int grid_col = 0; grid_col < gridCols; grid_col++){
+            int at = grid_row * gridCols + grid_col;
+            int width = std::min(blockCols, arenaCols - grid_col * blockCols);
+
+            uint16_t cell;
+            if (live[at] == 1){
+                int index = live_index_sum[at];
+                char character = index >= 0 && index < static_cast<int>(characters.size()) ? characters[index] : '?';
+                cell = cell_robot | static_cast<unsigned char>(character);
+            }
+            else if (live[at] > 1){
+                cell = cell_terrain | static_cast<unsigned char>('0' + std::min(live[at], 9));
+            }
+            else if (dead[at] > 0){
+                cell = cell_terrain | 'x';
+            }
+            else{
+                int area = height * width;
+                const char* density = ".:=H";
+                int level = terrain[at] == 0 ? 0 : std::min(3, 1 + 2 * terrain[at] / area);
+                cell = cell_terrain | static_cast<unsigned char>(density[level]);
+            }
+            cells[at] = cell;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+// Counts of what is in each block of cells, for drawing an arena that is too big for
+// the terminal. The counts are built once and then kept up to date as robots move and
+// die, so drawing the minimap only looks at the blocks, never at the cells.
+class Minimap {
+    public:
+    // Starts over with blocks of block_rows x block_cols cells and nothing counted.
+    void reset(int arena_rows, int arena_cols, int block_rows, int block_cols);
+
+    bool active() const{
+        return blockRows > 0;
+    }
+    int rows() const{
+        return gridRows;
+    }
+    int cols() const{
+        return gridCols;
+    }
+    int block_rows() const{
+        return blockRows;
+    }
+    int block_cols() const{
+        return blockCols;
+    }
+
+    void add_terrain(int row, int col);
+    // delta is +1 when a robot arrives in a cell and -1 when it leaves.
+    void add_robot(int row, int col, int index, bool alive, int delta);
+
+    // One code per block, row by row (see CellKind). A block with a single live robot
+    // shows that robot, more than one shows how many, and blocks holding only wrecks
+    // show 'x'. Otherwise the glyph gets denser with the share of terrain: . : = H
+    void glyphs(const std::vector<char>& characters, std::vector<uint16_t>& cells) const;
+
+    private:
+    int arenaRows = 0;
+    int arenaCols = 0;
+    int blockRows = 0;
+    int blockCols = 0;
+    int gridRows = 0;
+    int gridCols = 0;
+    std::vector<int> live;
+    std::vector<int> live_index_sum;   // with one live robot, this is its index
+    std::vector<int> dead;
+    std::vector<int> terrain;
+
+    int block(int row, int col) const{
+        return (row / blockRows) * gridCols + col / blockCols;
+    }
+};
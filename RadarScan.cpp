@@ -0,0 +1,117 @@
+#include "RadarScan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RADAR_SCAN_X86 1
+#endif
+
+static int find_busy_word_scalar(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    for (int word = from; word <= to; word++){
+        if ((a[word] | b[word] | c[word]) != 0){
+            return word;
+        }
+    }
+    return -1;
+}
+
+static int find_busy_word_reverse_scalar(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    for (int word = from; word >= to; word--){
+        if ((a[word] | b[word] | c[word]) != 0){
+            return word;
+        }
+    }
+    return -1;
+}
+
+#ifdef RADAR_SCAN_X86
+
+// SSE2 is part of x86-64, so this one needs no runtime check.
+static int find_busy_word_sse2(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    const __m128i zero = _mm_setzero_si128();
+    int word = from;
+    for (; word + 1 <= to; word += 2){
+        __m128i lanes = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + word)),
+                        _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + word)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + word))));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(lanes, zero)) != 0xFFFF){
+            break;
+        }
+    }
+    return find_busy_word_scalar(a, b, c, word, to);
+}
+
+static int find_busy_word_reverse_sse2(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    const __m128i zero = _mm_setzero_si128();
+    int word = from;
+    for (; word - 1 >= to; word -= 2){
+        __m128i lanes = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + word - 1)),
+                        _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + word - 1)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + word - 1))));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(lanes, zero)) != 0xFFFF){
+            break;
+        }
+    }
+    return find_busy_word_reverse_scalar(a, b, c, word, to);
+}
+
+__attribute__((target("avx2")))
+static int find_busy_word_avx2(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    int word = from;
+    for (; word + 3 <= to; word += 4){
+        __m256i lanes = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + word)),
+                        _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + word)),
+                                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + word))));
+        if (!_mm256_testz_si256(lanes, lanes)){
+            break;
+        }
+    }
+    return find_busy_word_scalar(a, b, c, word, to);
+}
+
+__attribute__((target("avx2")))
+static int find_busy_word_reverse_avx2(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    int word = from;
+    for (; word - 3 >= to; word -= 4){
+        __m256i lanes = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + word - 3)),
+                        _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + word - 3)),
+                                        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(c + word - 3))));
+        if (!_mm256_testz_si256(lanes, lanes)){
+            break;
+        }
+    }
+    return find_busy_word_reverse_scalar(a, b, c, word, to);
+}
+
+typedef int (*FindBusyWord)(const uint64_t*, const uint64_t*, const uint64_t*, int, int);
+
+// __builtin_cpu_supports reads what libgcc's constructor fills in, and nothing makes
+// that run before these static initializers, e.g. when this is linked into a shared
+// library, so it is filled in here first. Calling __builtin_cpu_init twice is harmless.
+static bool detect_avx2(){
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static const bool has_avx2 = detect_avx2();
+static const FindBusyWord find_forward = has_avx2 ? find_busy_word_avx2 : find_busy_word_sse2;
+static const FindBusyWord find_reverse = has_avx2 ? find_busy_word_reverse_avx2 : find_busy_word_reverse_sse2;
+
+int find_busy_word(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    return find_forward(a, b, c, from, to);
+}
+
+int find_busy_word_reverse(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    return find_reverse(a, b, c, from, to);
+}
+
+#else
+
+int find_busy_word(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    return find_busy_word_scalar(a, b, c, from, to);
+}
+
+int find_busy_word_reverse(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to){
+    return find_busy_word_reverse_scalar(a, b, c, from, to);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <bit>
+
+// Every directional radar ray is three parallel lanes, and each lane lies on one line
+// of the arena: a row, a column, a diagonal (row - col fixed) or an anti-diagonal
+// (row + col fixed). A LinePlane keeps one bit per cell laid out line by line, so the
+// three lanes of any ray can be scanned side by side with the same position index.
+enum LineFamily { line_rows, line_cols, line_diagonals, line_anti_diagonals };
+
+struct LinePlane {
+    int lines = 0;
+    int words = 0;    // 64-bit words per line
+    std::vector<uint64_t> bits;
+
+    // Two empty lines are kept before and after the real ones because the outer lanes
+    // of a diagonal ray sit two lines away from the centre lane.
+    void resize(int line_count, int length){
+        lines = line_count;
+        words = (length + 63) / 64;
+        bits.assign(static_cast<size_t>(lines + 4) * words, 0);
+    }
+
+    const uint64_t* line(int index) const{
+        return bits.data() + static_cast<size_t>(index + 2) * words;
+    }
+
+    void set(int index, int pos, bool on){
+        uint64_t& word = bits[static_cast<size_t>(index + 2) * words + (pos >> 6)];
+        uint64_t mask = uint64_t(1) << (pos & 63);
+        if (on){
+            word |= mask;
+        }
+        else{
+            word &= ~mask;
+        }
+    }
+};
+
+// First word index in [from, to] where any of the three lanes has a bit set, or -1.
+// Uses AVX2 or SSE2 to skip empty stretches when the CPU has them.
+int find_busy_word(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to);
+
+// Same as find_busy_word but walks from 'from' down to 'to'.
+int find_busy_word_reverse(const uint64_t* a, const uint64_t* b, const uint64_t* c, int from, int to);
+
+// Calls visit(pos) for every position in [first, last] where one of the lanes is set,
+// in the order the ray travels (ascending when forward, descending otherwise).
+template <typename Visit>
+void scan_lanes(const uint64_t* a, const uint64_t* b, const uint64_t* c,
+                int first, int last, bool forward, Visit&& visit){
+    if (first > last){
+        return;
+    }
+    int first_word = first >> 6;
+    int last_word = last >> 6;
+
+    int word = forward ? first_word : last_word;
+    while (true){
+        word = forward ? find_busy_word(a, b, c, word, last_word)
+                       : find_busy_word_reverse(a, b, c, word, first_word);
+        if (word < 0){
+            return;
+        }
+
+        uint64_t bits = a[word] | b[word] | c[word];
+        if (word == first_word){
+            bits &= ~uint64_t(0) << (first & 63);
+        }
+        if (word == last_word && (last & 63) != 63){
+            bits &= (uint64_t(1) << ((last & 63) + 1)) - 1;
+        }
+
+        while (bits != 0){
+            int bit = forward ? std::countr_zero(bits) : 63 - std::countl_zero(bits);
+            bits &= ~(uint64_t(1) << bit);
+            visit(word * 64 + bit);
+        }
+
+        word += forward ? 1 : -1;
+        if (forward ? word > last_word : word < first_word){
+            return;
+        }
+    }
+}
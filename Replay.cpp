@@ -0,0 +1,367 @@
+#include <cstring>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Replay.h"
+
+static const char replay_magic[] = "RWZREPLAY2";
+static const size_t replay_magic_size = sizeof(replay_magic) - 1;
+static const char index_magic[] = "RWZI";
+static const size_t trailer_size = 8 + 8 + 4 + 4 + 4;
+static const size_t index_entry_size = 8 + 8;
+
+static void put_fixed(std::vector<uint8_t>& bytes, uint64_t value, int size){
+    for (int i = 0; i < size; i++){
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+static uint64_t get_fixed(const uint8_t* data, int size){
+    uint64_t value = 0;
+    for (int i = 0; i < size; i++){
+        value |= static_cast<uint64_t>(data[i]) << (8 * i);
+    }
+    return value;
+}
+
+ReplayWriter::ReplayWriter(const std::string& fileName, int keyframe_interval)
+    : keyframeInterval(std::max(1, keyframe_interval)){
+    file.open(fileName, std::ios::binary | std::ios::trunc);
+    file_ok = file.good();
+}
+
+void ReplayWriter::put(uint64_t value){
+    while (value >= 0x80){
+        bytes.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<uint8_t>(value));
+}
+
+void ReplayWriter::put_signed(int64_t value){
+    put((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void ReplayWriter::put_event(int robot, ReplayEventKind kind){
+    put(static_cast<uint64_t>(robot) * 8 + kind);
+}
+
+void ReplayWriter::begin(uint64_t seed, int arena_rows, int arena_cols, int max_rounds,
+                         const std::vector<ReplayTerrain>& terrain, const std::vector<ReplayRobot>& robots){
+    bytes.assign(replay_magic, replay_magic + replay_magic_size);
+    round_offsets.clear();
+    round_hashes.clear();
+    round_offsets.reserve(max_rounds);
+    round_hashes.reserve(max_rounds);
+    put(seed);
+    put(arena_rows);
+    put(arena_cols);
+    put(max_rounds);
+    put(keyframeInterval);
+
+    put(terrain.size());
+    int previous = 0;
+    for (const ReplayTerrain& cell : terrain){
+        int at = cell.row * arena_cols + cell.col;
+        put(at - previous);
+        bytes.push_back(static_cast<uint8_t>(cell.type));
+        previous = at;
+    }
+
+    put(robots.size());
+    rows.clear();
+    cols.clear();
+    for (const ReplayRobot& robot : robots){
+        put(robot.name.size());
+        bytes.insert(bytes.end(), robot.name.begin(), robot.name.end());
+        bytes.push_back(static_cast<uint8_t>(robot.character));
+        put(robot.row);
+        put(robot.col);
+        put(robot.health);
+        put(robot.armor);
+        rows.push_back(robot.row);
+        cols.push_back(robot.col);
+    }
+}
+
+bool ReplayWriter::is_keyframe(int round) const{
+    return (round - 1) % keyframeInterval == 0;
+}
+
+void ReplayWriter::begin_round(int round, const std::vector<ReplayRobot>& robots, uint64_t state_hash){
+    round_offsets.push_back(bytes.size());
+    round_hashes.push_back(state_hash);
+    if (!is_keyframe(round)){
+        bytes.push_back(0);
+        return;
+    }
+    bytes.push_back(1);
+    for (size_t i = 0; i < robots.size() && i < rows.size(); i++){
+        put(robots[i].row);
+        put(robots[i].col);
+        put(robots[i].health);
+        put(robots[i].armor);
+        rows[i] = robots[i].row;
+        cols[i] = robots[i].col;
+    }
+}
+
+void ReplayWriter::radar(int robot, int direction){
+    put_event(robot, replay_radar);
+    put(direction);
+}
+
+void ReplayWriter::shot(int robot, int target_row, int target_col){
+    put_event(robot, replay_shot);
+    put_signed(target_row - rows[robot]);
+    put_signed(target_col - cols[robot]);
+}
+
+void ReplayWriter::move(int robot, int row, int col){
+    put_event(robot, replay_move);
+    put_signed(row - rows[robot]);
+    put_signed(col - cols[robot]);
+    rows[robot] = row;
+    cols[robot] = col;
+}
+
+void ReplayWriter::damage(int robot, int amount){
+    put_event(robot, replay_damage);
+    put(amount);
+}
+
+void ReplayWriter::death(int robot){
+    put_event(robot, replay_death);
+}
+
+void ReplayWriter::finish(uint64_t final_hash){
+    uint64_t index_offset = bytes.size();
+    for (size_t i = 0; i < round_offsets.size(); i++){
+        put_fixed(bytes, round_offsets[i], 8);
+        put_fixed(bytes, round_hashes[i], 8);
+    }
+    put_fixed(bytes, index_offset, 8);
+    put_fixed(bytes, final_hash, 8);
+    put_fixed(bytes, round_offsets.size(), 4);
+    put_fixed(bytes, keyframeInterval, 4);
+    bytes.insert(bytes.end(), index_magic, index_magic + 4);
+
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    file.close();
+    file_ok = !file.fail();
+}
+
+// Reads varints out of a mapped block, stopping cleanly at the end of the block
+// instead of running off it if the file is damaged.
+struct ReplayCursor {
+    const uint8_t* at;
+    const uint8_t* end;
+    bool bad = false;
+
+    bool done() const{
+        return at >= end || bad;
+    }
+
+    uint64_t next(){
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7){
+            if (at >= end){
+                bad = true;
+                return 0;
+            }
+            uint8_t byte = *at++;
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0){
+                return value;
+            }
+        }
+        bad = true;
+        return 0;
+    }
+
+    int64_t next_signed(){
+        uint64_t value = next();
+        return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+    }
+
+    uint8_t byte(){
+        if (at >= end){
+            bad = true;
+            return 0;
+        }
+        return *at++;
+    }
+};
+
+ReplayReader::~ReplayReader(){
+    if (data != nullptr){
+        munmap(const_cast<uint8_t*>(data), size);
+    }
+}
+
+bool ReplayReader::open(const std::string& fileName){
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0){
+        errorText = "could not open " + fileName;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < replay_magic_size + trailer_size){
+        ::close(fd);
+        errorText = fileName + " is too short to be a replay";
+        return false;
+    }
+    size = info.st_size;
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped == MAP_FAILED){
+        errorText = "could not map " + fileName;
+        return false;
+    }
+    data = static_cast<const uint8_t*>(mapped);
+
+    const uint8_t* trailer = data + size - trailer_size;
+    if (memcmp(data, replay_magic, replay_magic_size) != 0 || memcmp(trailer + 24, index_magic, 4) != 0){
+        errorText = fileName + " is not a replay";
+        return false;
+    }
+    uint64_t index_offset = get_fixed(trailer, 8);
+    finalHash = get_fixed(trailer + 8, 8);
+    roundCount = get_fixed(trailer + 16, 4);
+    if (index_offset + static_cast<uint64_t>(roundCount) * index_entry_size != size - trailer_size){
+        errorText = fileName + " has a damaged round index";
+        return false;
+    }
+    index = data + index_offset;
+
+    ReplayCursor cursor{data + replay_magic_size, index};
+    gameSeed = cursor.next();
+    arenaRows = cursor.next();
+    arenaCols = cursor.next();
+    maxRounds = cursor.next();
+    keyframeInterval = std::max<int>(1, cursor.next());
+
+    size_t terrain_count = cursor.next();
+    int at = 0;
+    for (size_t i = 0; i < terrain_count && !cursor.bad; i++){
+        at += cursor.next();
+        char type = cursor.byte();
+        terrainCells.push_back({at / std::max(1, arenaCols), at % std::max(1, arenaCols), type});
+    }
+
+    size_t robot_count = cursor.next();
+    for (size_t i = 0; i < robot_count && !cursor.bad; i++){
+        ReplayRobot robot;
+        size_t length = cursor.next();
+        if (length > static_cast<size_t>(cursor.end - cursor.at)){
+            cursor.bad = true;
+            break;
+        }
+        robot.name.assign(reinterpret_cast<const char*>(cursor.at), length);
+        cursor.at += length;
+        robot.character = cursor.byte();
+        robot.row = cursor.next();
+        robot.col = cursor.next();
+        robot.health = cursor.next();
+        robot.armor = cursor.next();
+        roster.push_back(robot);
+    }
+
+    if (cursor.bad || (roundCount > 0 && round_start(1) != cursor.at)){
+        errorText = fileName + " has a damaged header";
+        return false;
+    }
+    return true;
+}
+
+const uint8_t* ReplayReader::round_start(int round) const{
+    if (round > roundCount){
+        return index;
+    }
+    return data + get_fixed(index + static_cast<size_t>(round - 1) * index_entry_size, 8);
+}
+
+uint64_t ReplayReader::round_hash(int round) const{
+    if (data == nullptr || round < 1 || round > roundCount + 1){
+        return 0;
+    }
+    if (round > roundCount){
+        return finalHash;
+    }
+    return get_fixed(index + static_cast<size_t>(round - 1) * index_entry_size + 8, 8);
+}
+
+// Applies one round block: its keyframe if it has one, then its events unless only the
+// state at the start of the round is wanted.
+void ReplayReader::play_round(int round, ReplayState& state, bool events) const{
+    const uint8_t* start = round_start(round);
+    const uint8_t* end = round_start(round + 1);
+    if (start < data || end > index || start >= end){
+        return;
+    }
+    ReplayCursor cursor{start, end};
+    std::vector<ReplayRobot>& robots = state.robots;
+
+    if (cursor.byte() == 1){
+        for (ReplayRobot& robot : robots){
+            robot.row = cursor.next();
+            robot.col = cursor.next();
+            robot.health = cursor.next();
+            robot.armor = cursor.next();
+        }
+    }
+    if (!events){
+        return;
+    }
+
+    while (!cursor.done()){
+        uint64_t tag = cursor.next();
+        size_t which = tag / 8;
+        if (which >= robots.size()){
+            return;
+        }
+        ReplayRobot& robot = robots[which];
+        switch (tag % 8){
+            case replay_radar:
+                robot.radar = cursor.next();
+                break;
+            case replay_shot:
+                robot.shot_row = robot.row + cursor.next_signed();
+                robot.shot_col = robot.col + cursor.next_signed();
+                break;
+            case replay_move:
+                robot.row += cursor.next_signed();
+                robot.col += cursor.next_signed();
+                break;
+            case replay_damage:
+                robot.health = std::max<int>(0, robot.health - cursor.next());
+                robot.armor = std::max(0, robot.armor - 1);
+                break;
+            case replay_death:
+                robot.health = 0;
+                break;
+            default:
+                return;
+        }
+    }
+}
+
+bool ReplayReader::seek(int round, ReplayState& state) const{
+    if (data == nullptr || round < 1 || round > roundCount + 1){
+        return false;
+    }
+    state.round = round;
+    state.robots = roster;
+    if (roundCount == 0){
+        return true;
+    }
+
+    int last = std::min(round, roundCount);
+    int keyframe = (last - 1) / keyframeInterval * keyframeInterval + 1;
+    for (int block = keyframe; block <= last; block++){
+        play_round(block, state, block < round);
+    }
+    return true;
+}
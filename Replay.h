@@ -0,0 +1,158 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <fstream>
+
+// Replay files record a game so it can be looked at again without running any robot
+// code. Layout:
+//
+//   header   "RWZREPLAY2", then as varints: seed, rows, cols, max rounds, keyframe
+//            interval; the terrain as (cell index gap, type byte) pairs; and the
+//            roster: name, character, start row, col, health and armor per robot.
+//   rounds   one block per round played. Blocks on keyframe rounds start with the
+//            full robot state; every block then lists the events of that round.
+//   index    per round block, its 8 byte little-endian file offset and the 8 byte state
+//            hash at the start of the round (see StateHash.h).
+//   trailer  index offset (8 bytes), state hash at the end of the game (8), round
+//            count (4), keyframe interval (4), "RWZI".
+//
+// Numbers are varints, signed ones zigzag encoded first. Event positions are stored
+// relative to the robot's current cell, so most fit in a byte. The fixed size index
+// and trailer let a reader mapping the file go straight to any round. The hashes let a
+// rerun of the game from the same seed be checked against the recording.
+
+enum ReplayEventKind {
+    replay_radar,     // direction
+    replay_shot,      // target row, col, relative to the shooter
+    replay_move,      // new row, col, relative to the old ones
+    replay_damage,    // damage taken; armor also goes down by one
+    replay_death
+};
+
+struct ReplayRobot {
+    std::string name;
+    char character = '?';
+    int row = 0;
+    int col = 0;
+    int health = 0;
+    int armor = 0;
+    int radar = 0;          // last radar direction
+    int shot_row = -1;      // last shot target, -1 if it hasn't fired
+    int shot_col = -1;
+};
+
+struct ReplayTerrain {
+    int row;
+    int col;
+    char type;
+};
+
+// Arena state at the start of a round.
+struct ReplayState {
+    int round = 0;
+    std::vector<ReplayRobot> robots;
+};
+
+class ReplayWriter {
+    public:
+    static const int default_keyframe_interval = 16;
+
+    ReplayWriter(const std::string& fileName, int keyframe_interval = default_keyframe_interval);
+    bool ok() const{
+        return file_ok;
+    }
+
+    void begin(uint64_t seed, int rows, int cols, int max_rounds,
+               const std::vector<ReplayTerrain>& terrain, const std::vector<ReplayRobot>& robots);
+    bool is_keyframe(int round) const;
+    // robots is the state at the start of the round; it is only written on keyframes.
+    void begin_round(int round, const std::vector<ReplayRobot>& robots, uint64_t state_hash);
+    void radar(int robot, int direction);
+    void shot(int robot, int target_row, int target_col);
+    void move(int robot, int row, int col);
+    void damage(int robot, int amount);
+    void death(int robot);
+    // Writes the index and trailer and closes the file.
+    void finish(uint64_t final_hash);
+
+    private:
+    std::ofstream file;
+    bool file_ok = true;
+    int keyframeInterval;
+    std::vector<uint8_t> bytes;
+    std::vector<uint64_t> round_offsets;
+    std::vector<uint64_t> round_hashes;
+    std::vector<int> rows;      // where each robot is, for relative positions
+    std::vector<int> cols;
+
+    void put(uint64_t value);
+    void put_signed(int64_t value);
+    void put_event(int robot, ReplayEventKind kind);
+};
+
+// Reads a replay by mapping the file into memory. Seeking decodes from the nearest
+// keyframe at or before the round, so it never reads more than one interval of rounds.
+class ReplayReader {
+    public:
+    ReplayReader() = default;
+    ~ReplayReader();
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+
+    // Returns false with a message in error() if the file can't be used.
+    bool open(const std::string& fileName);
+    const std::string& error() const{
+        return errorText;
+    }
+
+    uint64_t seed() const{
+        return gameSeed;
+    }
+    int rows() const{
+        return arenaRows;
+    }
+    int cols() const{
+        return arenaCols;
+    }
+    int max_rounds() const{
+        return maxRounds;
+    }
+    int rounds() const{
+        return roundCount;
+    }
+    int keyframe_interval() const{
+        return keyframeInterval;
+    }
+    const std::vector<ReplayTerrain>& terrain() const{
+        return terrainCells;
+    }
+    // The robots as the game started.
+    const std::vector<ReplayRobot>& robots() const{
+        return roster;
+    }
+
+    // State at the start of round, 1 to rounds(); rounds() + 1 is the end of the game.
+    bool seek(int round, ReplayState& state) const;
+    // The recorded state hash for the same rounds.
+    uint64_t round_hash(int round) const;
+
+    private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    std::string errorText;
+    uint64_t gameSeed = 0;
+    int arenaRows = 0;
+    int arenaCols = 0;
+    int maxRounds = 0;
+    int roundCount = 0;
+    int keyframeInterval = 1;
+    uint64_t finalHash = 0;
+    std::vector<ReplayTerrain> terrainCells;
+    std::vector<ReplayRobot> roster;
+    const uint8_t* index = nullptr;
+
+    const uint8_t* round_start(int round) const;
+    void play_round(int round, ReplayState& state, bool events) const;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+// Small, fast, seedable random number generator (xoshiro256**). Each Arena owns its
+// own streams so games can be replayed from a seed and several Arenas can run on
+// different threads without sharing the global rand() state.
+class Rng {
+    private:
+    uint64_t state[4];
+
+    static uint64_t rotl(uint64_t x, int k){
+        return (x << k) | (x >> (64 - k));
+    }
+
+    // splitmix64, used to spread a seed over the whole state.
+    static uint64_t split_mix(uint64_t& x){
+        uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    public:
+    Rng(uint64_t seed = 0, uint64_t stream = 0){
+        reseed(seed, stream);
+    }
+
+    // Different stream numbers give unrelated sequences from the same seed.
+    void reseed(uint64_t seed, uint64_t stream = 0){
+        uint64_t x = seed ^ (stream * 0xd1b54a32d192ed03ULL);
+        for (auto& word : state){
+            word = split_mix(x);
+        }
+    }
+
+    uint64_t next(){
+        uint64_t result = rotl(state[1] * 5, 7) * 9;
+        uint64_t t = state[1] << 17;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl(state[3], 45);
+
+        return result;
+    }
+
+    // Uniform in [0, n). n must be positive.
+    int below(int n){
+        return static_cast<int>(((next() >> 32) * static_cast<uint64_t>(n)) >> 32);
+    }
+
+    // Uniform in [low, high].
+    int range(int low, int high){
+        return low + below(high - low + 1);
+    }
+};
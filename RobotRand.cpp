@@ -0,0 +1,62 @@
+#include "RobotRand.h"
+
+namespace {
+
+// glibc's TYPE_3 additive feedback generator: 31 words, taps 3 apart.
+struct RandState {
+    uint32_t words[31];
+    int front = 3;
+    int rear = 0;
+    bool seeded = false;
+
+    int next(){
+        words[front] += words[rear];
+        int result = words[front] >> 1;
+        front = front + 1 < 31 ? front + 1 : 0;
+        rear = rear + 1 < 31 ? rear + 1 : 0;
+        return result;
+    }
+
+    void seed(uint32_t value){
+        if (value == 0){
+            value = 1;
+        }
+        int32_t word = static_cast<int32_t>(value);
+        words[0] = word;
+        for (int i = 1; i < 31; i++){
+            // 16807 * word % (2^31 - 1) without overflowing, as glibc does it.
+            int32_t hi = word / 127773;
+            int32_t lo = word % 127773;
+            word = 16807 * lo - 2836 * hi;
+            if (word < 0){
+                word += 2147483647;
+            }
+            words[i] = word;
+        }
+        front = 3;
+        rear = 0;
+        seeded = true;
+        for (int i = 0; i < 310; i++){
+            next();
+        }
+    }
+};
+
+thread_local RandState rand_state;
+
+}
+
+void seed_robot_rand(uint64_t seed){
+    rand_state.seed(static_cast<uint32_t>(seed));
+}
+
+extern "C" int robot_rand(){
+    if (!rand_state.seeded){
+        rand_state.seed(1);
+    }
+    return rand_state.next();
+}
+
+// Robots seed from the clock, which would make every game different; the arena seeds.
+extern "C" void robot_srand(unsigned){
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+
+// Robots get their random numbers from rand(), and most call srand(time(nullptr)) when
+// they're built. Robot code is compiled with ROBOTWARZ_ROBOT_CODE defined and this
+// header forced in (see compileRobot and the Robot_%.bundle.o rule), which points its
+// rand() and srand() at robot_rand() and robot_srand(); the C library's own are left
+// alone for the rest of the program. robot_rand() draws from the calling thread's own
+// state and robot_srand() is ignored. The arena reseeds the state from its seed before
+// every game, so a game depends on its seed alone, on whichever thread it runs and
+// whatever ran there before. The numbers are the ones glibc's rand() gives after the
+// same srand().
+extern "C" int robot_rand();
+extern "C" void robot_srand(unsigned seed);
+void seed_robot_rand(uint64_t seed);
+
+#ifdef ROBOTWARZ_ROBOT_CODE
+// std::rand() turns into std::robot_rand(), so std needs the names as well.
+namespace std {
+using ::robot_rand;
+using ::robot_srand;
+}
+#define rand robot_rand
+#define srand robot_srand
+#endif
@@ -0,0 +1,12 @@
+#pragma once
+#include "RobotBase.h"
+
+// Robots linked straight into the binary by 'make bundle'. The table itself is in
+// robot_registry.cpp, which the Makefile generates from the Robot_*.cpp files in file
+// name order. It ends with an entry whose name is nullptr.
+struct BundledRobot {
+    const char* name;
+    RobotFactory factory;
+};
+
+extern const BundledRobot bundled_robots[];
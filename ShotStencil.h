@@ -0,0 +1,94 @@
+#pragma once
+#include <array>
+#include <cstdint>
+
+#include "RobotBase.h"
+
+// The cells a shot can reach, as offsets from an anchor cell. These are all built at
+// compile time so resolving a shot is just clipping one of them to the arena.
+struct StencilCell {
+    int8_t row;
+    int8_t col;
+};
+
+struct ShotStencil {
+    int count = 0;
+    StencilCell cells[12] = {};
+};
+
+// Shot direction as an index into 'directions' from RobotBase.h, 0 when the shot is
+// aimed at the shooter's own cell.
+constexpr int stencil_direction(int delta_row, int delta_col){
+    for (int dir = 1; dir <= 8; dir++){
+        if (directions[dir].first == delta_row && directions[dir].second == delta_col){
+            return dir;
+        }
+    }
+    return 0;
+}
+
+// Flame is 3 cells wide and 4 long, anchored at the shooter. Lanes are listed
+// nearest first, then left to right across the perpendicular, same as the arena
+// has always applied damage. With no direction the flame stays on the shooter's
+// column and the same three cells are hit four times.
+constexpr ShotStencil make_flame_stencil(int direction){
+    int delta_row = directions[direction].first;
+    int delta_col = directions[direction].second;
+
+    int side_row, side_col;
+    if (delta_row == 0){
+        side_row = 1;
+        side_col = 0;
+    }
+    else if (delta_col == 0){
+        side_row = 0;
+        side_col = 1;
+    }
+    else{  // Diagonal direction - perpendicular is (-delta_col, delta_row)
+        side_row = -delta_col;
+        side_col = delta_row;
+    }
+
+    ShotStencil stencil;
+    for (int dist = 1; dist <= 4; dist++){
+        for (int offset = -1; offset <= 1; offset++){
+            stencil.cells[stencil.count++] = {static_cast<int8_t>(delta_row * dist + side_row * offset),
+                                              static_cast<int8_t>(delta_col * dist + side_col * offset)};
+        }
+    }
+    return stencil;
+}
+
+constexpr std::array<ShotStencil, 9> make_flame_stencils(){
+    std::array<ShotStencil, 9> stencils;
+    for (int direction = 0; direction <= 8; direction++){
+        stencils[direction] = make_flame_stencil(direction);
+    }
+    return stencils;
+}
+
+// Grenade blast: the 3x3 box around the target, row by row.
+constexpr ShotStencil make_grenade_stencil(){
+    ShotStencil stencil;
+    for (int row = -1; row <= 1; row++){
+        for (int col = -1; col <= 1; col++){
+            stencil.cells[stencil.count++] = {static_cast<int8_t>(row), static_cast<int8_t>(col)};
+        }
+    }
+    return stencil;
+}
+
+// Hammer: just the target cell.
+constexpr ShotStencil make_hammer_stencil(){
+    ShotStencil stencil;
+    stencil.cells[stencil.count++] = {0, 0};
+    return stencil;
+}
+
+constexpr std::array<ShotStencil, 9> flame_stencils = make_flame_stencils();
+constexpr ShotStencil grenade_stencil = make_grenade_stencil();
+constexpr ShotStencil hammer_stencil = make_hammer_stencil();
+
+static_assert(flame_stencils[3].count == 12 && flame_stencils[3].cells[0].row == -1 && flame_stencils[3].cells[0].col == 1,
+              "flame to the right starts one cell over, on the upper lane");
+static_assert(grenade_stencil.count == 9, "grenade covers a 3x3 box");
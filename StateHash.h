@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+// Zobrist style hash of an arena's state. Every feature (robot 3 is at cell 117, robot
+// 3 has 40 health, cell 52 is a pit, ...) has its own random 64 bit key, and the state
+// hash is the XOR of the keys of every feature that holds. Changing one feature means
+// XORing its old key out and its new key in.
+//
+// A table of keys would need one per robot per cell, so keys are made by mixing the
+// feature's numbers instead. The keys are fixed: the same state always has the same
+// hash, in any build and on any machine.
+enum HashFeature : uint64_t {
+    hash_terrain,     // who: cell index, value: terrain character
+    hash_position,    // who: robot index, value: cell index
+    hash_health,
+    hash_armor,
+    hash_grenades
+};
+
+// splitmix64's finalizer, which spreads every input bit over the whole word.
+inline uint64_t hash_mix(uint64_t z){
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+inline uint64_t hash_key(HashFeature feature, uint64_t who, uint64_t value){
+    return hash_mix(hash_mix(who * 8 + feature + 0x9e3779b97f4a7c15ULL) + value);
+}
+
+// Set of state hashes, for spotting a state that comes back. Open addressing in one
+// array: once the table has grown as big as a game needs, inserting doesn't allocate,
+// and clear() only touches the slots that were used.
+class StateSet {
+    public:
+    // Returns false when hash was already in the set.
+    bool insert(uint64_t hash){
+        if (hash == 0){
+            bool added = !has_zero;
+            has_zero = true;
+            return added;
+        }
+        if ((used.size() + 1) * 2 > slots.size()){
+            grow();
+        }
+        size_t mask = slots.size() - 1;
+        size_t at = hash & mask;
+        while (slots[at] != 0){
+            if (slots[at] == hash){
+                return false;
+            }
+            at = (at + 1) & mask;
+        }
+        slots[at] = hash;
+        used.push_back(at);
+        return true;
+    }
+
+    bool empty() const{
+        return used.empty() && !has_zero;
+    }
+
+    void clear(){
+        for (size_t at : used){
+            slots[at] = 0;
+        }
+        used.clear();
+        has_zero = false;
+    }
+
+    private:
+    std::vector<uint64_t> slots;   // 0 marks an empty slot
+    std::vector<size_t> used;      // slots holding a hash
+    bool has_zero = false;
+
+    void grow(){
+        std::vector<uint64_t> old;
+        old.swap(slots);
+        slots.assign(std::max<size_t>(64, old.size() * 2), 0);
+        used.clear();
+        used.reserve(slots.size() / 2);
+        size_t mask = slots.size() - 1;
+        for (uint64_t hash : old){
+            if (hash != 0){
+                size_t at = hash & mask;
+                while (slots[at] != 0){
+                    at = (at + 1) & mask;
+                }
+                slots[at] = hash;
+                used.push_back(at);
+            }
+        }
+    }
+};
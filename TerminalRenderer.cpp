@@ -0,0 +1,155 @@
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+#include "TerminalRenderer.h"
+
+// Screen lines and columns are 1-based, as ANSI counts them. The round is on line 1,
+// the column numbers on line 2, and board row r on line 4 + r. Each cell is three
+// characters wide after the row label and two spaces.
+static const int board_line = 4;
+
+// Right aligns text in a field, like std::setw.
+static std::string padded(int value, int width){
+    std::string text = std::to_string(value);
+    return std::string(width - std::min<size_t>(width, text.size()), ' ') + text;
+}
+
+TerminalRenderer::TerminalRenderer(int fd) : fd(fd){
+}
+
+void TerminalRenderer::move_to(int line, int column){
+    if (line != cursor_line || column != cursor_column){
+        buffer += "\x1b[" + std::to_string(line) + ";" + std::to_string(column) + "H";
+    }
+    cursor_line = line;
+    cursor_column = column;
+}
+
+void TerminalRenderer::put(const std::string& text, int line, int column){
+    move_to(line, column);
+    buffer += text;
+    cursor_column += text.size();
+    if (text.find('\x1b') != std::string::npos){
+        cursor_line = -1;    // escape codes don't move the cursor the way plain text does
+    }
+}
+
+// Writes text at the start of a screen line and clears the rest of the line.
+void TerminalRenderer::put_line(const std::string& text, int line){
+    put(text, line, 1);
+    buffer += "\x1b[K";
+}
+
+void TerminalRenderer::put_cell(uint16_t cell, int row, int col){
+    char text[4] = {' ', ' ', static_cast<char>(cell & 0xff), '\0'};
+    if ((cell & 0xff00) == cell_robot){
+        text[1] = 'R';
+    }
+    else if ((cell & 0xff00) == cell_dead_robot){
+        text[1] = 'X';
+    }
+    put(text, board_line + row, board_column() + col * 3);
+}
+
+void TerminalRenderer::put_labels(){
+    // Three digit numbers would run together, so then only every other column gets one.
+    int last_col = first_col + (cols - 1) * col_step;
+    int every = last_col >= 100 ? 2 : 1;
+    std::string header(label_width + 1, ' ');
+    for (int column = 0; column < cols; column++){
+        header += column % every == 0 ? padded(first_col + column * col_step, 3) : "   ";
+    }
+    put(header + "\x1b[K", 2, 1);
+    for (int row = 0; row < rows; row++){
+        put(padded(first_row + row * row_step, label_width) + "  ", board_line + row, 1);
+    }
+}
+
+void TerminalRenderer::draw(const ArenaSnapshot& frame, const std::string& footer){
+    buffer.clear();
+
+    // New board size: clear the screen and draw everything once.
+    int last_row = frame.first_row + (frame.rows - 1) * frame.row_step;
+    int new_label_width = std::max<int>(2, std::to_string(last_row).size());
+    if (frame.rows != rows || frame.cols != cols || new_label_width != label_width){
+        rows = frame.rows;
+        cols = frame.cols;
+        label_width = new_label_width;
+        round = -1;
+        first_row = -1;
+        buffer += "\x1b[2J";
+        cursor_line = -1;
+        previous.assign(frame.cells.size(), 0xffff);
+        status_lines = 0;
+    }
+
+    // The labels move when a window follows a robot around.
+    if (frame.first_row != first_row || frame.first_col != first_col ||
+        frame.row_step != row_step || frame.col_step != col_step){
+        first_row = frame.first_row;
+        first_col = frame.first_col;
+        row_step = frame.row_step;
+        col_step = frame.col_step;
+        put_labels();
+    }
+
+    if (frame.round != round){
+        round = frame.round;
+        put("=========== starting round " + std::to_string(round) + " ===========\x1b[K", 1, 1);
+    }
+
+    const std::vector<uint16_t>& cells = frame.cells;
+    for (size_t i = 0; i < cells.size(); i++){
+        if (cells[i] != previous[i]){
+            put_cell(cells[i], i / cols, i % cols);
+            previous[i] = cells[i];
+        }
+    }
+
+    // The status lines, a blank line and the footer. Only lines that changed are
+    // redrawn and copied into previous_status, whose strings keep their capacity.
+    static const std::string blank;
+    size_t count = frame.status.size() + 2;
+    int status_line = board_line + rows + 1;
+    for (size_t i = 0; i < count; i++){
+        const std::string& line = i < frame.status.size() ? frame.status[i] : i == frame.status.size() ? blank : footer;
+        if (i < status_lines && line == previous_status[i]){
+            continue;
+        }
+        put_line(line, status_line + i);
+        if (i >= previous_status.size()){
+            previous_status.resize(i + 1);
+        }
+        previous_status[i] = line;
+    }
+    // Lines left over from a longer status list.
+    for (size_t i = count; i < status_lines; i++){
+        put_line(blank, status_line + i);
+    }
+    status_lines = count;
+
+    flush();
+}
+
+void TerminalRenderer::finish(){
+    buffer.clear();
+    move_to(board_line + rows + 1 + status_lines, 1);
+    buffer += "\n";
+    flush();
+    cursor_line = -1;
+}
+
+// One write() per frame, looping only if the terminal takes part of it.
+void TerminalRenderer::flush(){
+    size_t done = 0;
+    while (done < buffer.size()){
+        ssize_t count = write(fd, buffer.data() + done, buffer.size() - done);
+        if (count < 0){
+            if (errno == EINTR){
+                continue;
+            }
+            return;
+        }
+        done += count;
+    }
+}
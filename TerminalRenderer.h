@@ -0,0 +1,70 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// What one board cell shows: the character in the low byte and what kind of thing it
+// is in the high byte.
+enum CellKind : uint16_t {
+    cell_terrain = 0,
+    cell_robot = 1 << 8,
+    cell_dead_robot = 2 << 8
+};
+
+// Everything the live view needs to draw one round. The grid is either the whole
+// arena, a full size window onto part of it, or a minimap where each cell stands for
+// a block of arena cells. Grid cell (r, c) is labelled as arena cell
+// (first_row + r * row_step, first_col + c * col_step).
+struct ArenaSnapshot {
+    int round = 0;
+    int rows = 0;
+    int cols = 0;
+    int first_row = 0;
+    int first_col = 0;
+    int row_step = 1;
+    int col_step = 1;
+    std::vector<uint16_t> cells;        // rows * cols codes, row by row
+    std::vector<std::string> status;    // one line per robot
+};
+
+// Live view of the board for a terminal. The first frame is drawn in full; after that
+// only the cells, labels and status lines that changed are redrawn, using ANSI cursor
+// moves. Each frame is built in one buffer and handed to the terminal with a single
+// write(). The layout matches Arena::display().
+class TerminalRenderer {
+    public:
+    explicit TerminalRenderer(int fd = 1);
+
+    // footer is an extra line under the status lines.
+    void draw(const ArenaSnapshot& frame, const std::string& footer);
+
+    // Moves the cursor below the last frame so normal output can carry on.
+    void finish();
+
+    private:
+    int fd;
+    int rows = -1;
+    int cols = -1;
+    int round = -1;
+    int label_width = 2;
+    int first_row = -1;
+    int first_col = -1;
+    int row_step = 0;
+    int col_step = 0;
+    int cursor_line = -1;
+    int cursor_column = -1;
+    std::vector<uint16_t> previous;
+    std::vector<std::string> previous_status;
+    size_t status_lines = 0;    // lines of previous_status on screen
+    std::string buffer;
+
+    int board_column() const{
+        return label_width + 3;
+    }
+    void move_to(int line, int column);
+    void put(const std::string& text, int line, int column);
+    void put_line(const std::string& text, int line);
+    void put_cell(uint16_t cell, int row, int col);
+    void put_labels();
+    void flush();
+};
@@ -0,0 +1,141 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "Tournament.h"
+
+Tournament::Tournament(const std::string& configFile, int matches, int jobs, uint64_t seed)
+    : configFile(configFile), matches(matches), jobs(jobs), baseSeed(seed){
+    if (this->jobs < 1){
+        this->jobs = 1;
+    }
+}
+
+// Each worker keeps its own totals and only merges them once at the end, so workers
+// never wait on each other while games are running. A robot its factory fails to make
+// sits the match out; the results are credited through factory_of so every other
+// robot's still land in its own totals.
+void Tournament::play_matches(const std::vector<RobotFactory>& factories, const Arena& prototype,
+                              std::atomic<int>& next_match, std::vector<RobotTotals>& local, long& local_rounds,
+                              int& local_stalemates, int& local_failures){
+    std::vector<size_t> factory_of;    // arena robot index to factory index
+    while (true){
+        int match = next_match.fetch_add(1);
+        if (match >= matches){
+            return;
+        }
+
+        Arena arena = prototype;
+        arena.set_headless(true);
+        arena.set_seed(baseSeed + match);
+        arena.place_obstacles();
+        factory_of.clear();
+        for (size_t f = 0; f < factories.size(); f++){
+            RobotBase* robot = factories[f]();
+            if (robot == nullptr){
+                local_failures++;
+                continue;
+            }
+            arena.add_robot(robot);
+            factory_of.push_back(f);
+        }
+
+        MatchResult result = arena.run_game();
+        arena.cleanup();
+
+        local_rounds += result.rounds;
+        local_stalemates += result.stalemate;
+        for (size_t i = 0; i < result.robots.size(); i++){
+            const RobotResult& robot = result.robots[i];
+            RobotTotals& entry = local[factory_of[i]];
+            entry.name = robot.name;
+            entry.rounds_survived += robot.rounds_survived;
+            entry.damage_dealt += robot.damage_dealt;
+            if (result.winner == static_cast<int>(i)){
+                entry.wins++;
+            }
+            if (result.living == 0){
+                entry.draws++;
+            }
+        }
+    }
+}
+
+void Tournament::run(const std::vector<RobotFactory>& factories){
+    Arena prototype;
+    prototype.load_config(configFile);
+    prototype.set_watch_live(false);
+
+    totals.assign(factories.size(), RobotTotals());
+    total_rounds = 0;
+    stalemates = 0;
+    creation_failures = 0;
+
+    std::atomic<int> next_match(0);
+    std::mutex merge_lock;
+    std::vector<std::thread> workers;
+
+    auto start = std::chrono::steady_clock::now();
+    for (int job = 0; job < jobs; job++){
+        workers.emplace_back([&](){
+            std::vector<RobotTotals> local(factories.size());
+            long local_rounds = 0;
+            int local_stalemates = 0;
+            int local_failures = 0;
+            play_matches(factories, prototype, next_match, local, local_rounds, local_stalemates, local_failures);
+
+            std::lock_guard<std::mutex> guard(merge_lock);
+            total_rounds += local_rounds;
+            stalemates += local_stalemates;
+            creation_failures += local_failures;
+            for (size_t i = 0; i < local.size(); i++){
+                if (!local[i].name.empty()){
+                    totals[i].name = local[i].name;
+                }
+                totals[i].wins += local[i].wins;
+                totals[i].draws += local[i].draws;
+                totals[i].rounds_survived += local[i].rounds_survived;
+                totals[i].damage_dealt += local[i].damage_dealt;
+            }
+        });
+    }
+    for (auto& worker : workers){
+        worker.join();
+    }
+    seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void Tournament::report(std::ostream& stream) const{
+    std::vector<RobotTotals> ranked = totals;
+    std::stable_sort(ranked.begin(), ranked.end(), [](const RobotTotals& a, const RobotTotals& b){
+        return a.wins > b.wins;
+    });
+
+    double games = std::max(matches, 1);
+    stream << "\n========== TOURNAMENT ==========\n";
+    stream << matches << " matches on " << jobs << " threads in " << std::fixed << std::setprecision(2)
+           << seconds << "s (" << (seconds > 0 ? matches / seconds : 0) << " matches/s, "
+           << total_rounds / games << " rounds/match)\n";
+    if (stalemates > 0){
+        stream << stalemates << " matches ended early in a stalemate\n";
+    }
+    if (creation_failures > 0){
+        stream << creation_failures << " times a robot could not be created and sat the match out\n";
+    }
+    stream << "\n";
+
+    stream << std::left << std::setw(16) << "Robot" << std::right << std::setw(8) << "Wins"
+           << std::setw(8) << "Draws" << std::setw(10) << "Win %" << std::setw(14) << "Avg rounds"
+           << std::setw(14) << "Avg damage" << "\n";
+    for (const auto& robot : ranked){
+        stream << std::left << std::setw(16) << robot.name << std::right << std::setw(8) << robot.wins
+               << std::setw(8) << robot.draws << std::setw(10) << 100.0 * robot.wins / games
+               << std::setw(14) << robot.rounds_survived / games << std::setw(14) << robot.damage_dealt / games
+               << "\n";
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include "Arena.h"
+
+// Plays many headless games across a pool of worker threads, one Arena per game,
+// and adds up how every robot did. The robot libraries are loaded once up front and
+// their factories shared by all the workers.
+class Tournament {
+    private:
+    struct RobotTotals {
+        std::string name;
+        int wins = 0;
+        int draws = 0;
+        long rounds_survived = 0;
+        long damage_dealt = 0;
+    };
+
+    std::string configFile;
+    int matches;
+    int jobs;
+    uint64_t baseSeed;
+    std::vector<RobotTotals> totals;
+    long total_rounds = 0;
+    int stalemates = 0;
+    int creation_failures = 0;   // robots a factory returned nullptr for, over all matches
+    double seconds = 0;
+
+    void play_matches(const std::vector<RobotFactory>& factories, const Arena& prototype,
+                      std::atomic<int>& next_match, std::vector<RobotTotals>& local, long& local_rounds,
+                      int& local_stalemates, int& local_failures);
+
+    public:
+    Tournament(const std::string& configFile, int matches, int jobs, uint64_t seed);
+    void run(const std::vector<RobotFactory>& factories);
+    void report(std::ostream& stream) const;
+};
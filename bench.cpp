@@ -0,0 +1,561 @@
+#include <iostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <functional>
+#include <fstream>
+#include "Arena.h"
+#include "AllocCount.h"
+#include "Bench.h"
+#include "Rng.h"
+#include "RobotRegistry.h"
+
+// Benchmarks built by 'make bench', with the results written to stdout as JSON and
+// progress to stderr. Two suites:
+//
+//   micro    the arena's hot paths, each run for every arena size and robot count asked for
+//   matches  whole headless games, for every arena size, robot count, robot mix and radar
+//            cache size asked for: matches/s, rounds/s and round latency. Robots come from
+//            the ones linked in as by 'make bundle', from synthetic stress robots, or from
+//            both. Cache sizes other than 0 add _cache<MB> to the benchmark's name.
+//
+// --save FILE also writes the results to FILE, to keep as a baseline. --compare FILE
+// runs the benchmarks FILE holds, with the options they were run with, and prints how
+// each moved instead of the JSON. A benchmark has regressed when its median is more
+// than --threshold percent (10) slower and a Mann-Whitney test over the samples gives p
+// below --alpha (0.05); with fewer than 4 samples on each side the test can't get there.
+// Exits 1 if anything regressed and 2 on errors.
+//
+//   RobotWarz_bench [--suite micro|matches|all] [--samples N] [--seed N]
+//                   [--sizes 20,64,...] [--robots 3,30,...] [--min-ms MS] [--only NAME]
+//                   [--match-sizes 20,64,...] [--match-robots 6,30,...]
+//                   [--mixes bundled,stress,mixed] [--radar-cache 0,64,...]
+//                   [--matches N] [--rounds N] [--save FILE] [--compare FILE] [--threshold PCT] [--alpha P]
+
+// Stands still and never shoots; the benchmarks drive the arena directly.
+class BenchRobot : public RobotBase {
+    public:
+    explicit BenchRobot(WeaponType weapon) : RobotBase(3, 2, weapon){
+        m_name = "Bench";
+    }
+    void get_radar_direction(int& radar_direction) override{
+        radar_direction = 0;
+    }
+    void process_radar_results(const std::vector<RadarObj>&) override{}
+    bool get_shot_location(int&, int&) override{
+        return false;
+    }
+    void get_move_direction(int& direction, int& distance) override{
+        direction = 0;
+        distance = 0;
+    }
+};
+
+// Keeps the arena as busy as a robot can: scans every turn, sweeping round all eight
+// directions, fires its flamethrower or grenades every other turn once it has seen a
+// robot, and otherwise moves as far as it can. It never calls rand(), so its games
+// depend on the seed alone.
+class StressRobot : public RobotBase {
+    public:
+    explicit StressRobot(WeaponType weapon) : RobotBase(5, 0, weapon){
+        m_name = weapon == grenade ? "StressGrenade" : "StressFlame";
+    }
+    void get_radar_direction(int& radar_direction) override{
+        radar = radar % 8 + 1;
+        radar_direction = radar;
+    }
+    void process_radar_results(const std::vector<RadarObj>& radar_results) override{
+        target_row = -1;
+        for (const RadarObj& obj : radar_results){
+            if (obj.m_type == 'R'){
+                target_row = obj.m_row;
+                target_col = obj.m_col;
+                break;
+            }
+        }
+    }
+    bool get_shot_location(int& shot_row, int& shot_col) override{
+        turn++;
+        if (target_row < 0 || turn % 2 != 0){
+            return false;
+        }
+        shot_row = target_row;
+        shot_col = target_col;
+        return true;
+    }
+    void get_move_direction(int& direction, int& distance) override{
+        direction = (radar + turn) % 8 + 1;
+        distance = get_move_speed();
+    }
+
+    private:
+    int radar = 0;
+    int turn = 0;
+    int target_row = -1;
+    int target_col = -1;
+};
+
+// Throws away everything written to it, so display() can be timed without a terminal.
+class NullBuffer : public std::streambuf {
+    protected:
+    int overflow(int c) override{
+        return c;
+    }
+    std::streamsize xsputn(const char*, std::streamsize count) override{
+        return count;
+    }
+};
+
+static const char* weapon_names[] = {"flamethrower", "railgun", "grenade", "hammer"};
+
+// Sets arenas up and times their private hot paths; Arena names it as a friend.
+class ArenaBench {
+    public:
+    explicit ArenaBench(const BenchOptions& options) : options(options), null_stream(&null_buffer){}
+
+    void run(std::vector<BenchResult>& results){
+        for (int size : options.sizes){
+            run_place_obstacles(size, results);
+            for (int count : options.robot_counts){
+                // Robots need somewhere to stand among the obstacles.
+                if (static_cast<long>(count) * 4 > static_cast<long>(size) * size){
+                    continue;
+                }
+                run_size(size, count, results);
+            }
+        }
+    }
+
+    private:
+    const BenchOptions& options;
+    NullBuffer null_buffer;
+    std::ostream null_stream;
+    std::vector<std::pair<int, int>> cells;   // random cells, so inputs vary without timing an Rng
+
+    bool wanted(const std::string& name) const{
+        return options.only.empty() || name.compare(0, options.only.size(), options.only) == 0;
+    }
+
+    // A size by size arena with 2% each of mounds, pits and flamethrowers and no robots.
+    void set_up(Arena& arena, int size){
+        arena.set_seed(options.seed);
+        arena.set_headless(true);
+        arena.set_output(null_stream);
+        arena.set_watch_live(false);
+        arena.arenaHeight = size;
+        arena.arenaWidth = size;
+        arena.mounds = arena.pits = arena.flamethrowers = size * size / 50;
+        arena.maxRound = 1;
+        arena.maxRobots = 0;
+        arena.size_grid();
+    }
+
+    void add_robots(Arena& arena, int count, WeaponType weapon){
+        for (int i = 0; i < count; i++){
+            arena.add_robot(new BenchRobot(weapon));
+        }
+    }
+
+    // Runs op until min_ms has passed or max_ops calls have been made, once per sample,
+    // calling prepare untimed before each sample. op is given a running call number to
+    // pick its inputs with.
+    template <typename Op>
+    void measure(std::vector<BenchResult>& results, const std::string& name, int size, int robots,
+                 Op&& op, long max_ops = -1, const std::function<void()>& prepare = nullptr){
+        BenchResult result;
+        result.name = name;
+        result.arena = size;
+        result.robots = robots;
+        uint64_t allocations = 0;
+        long call = 0;
+        std::chrono::nanoseconds min_time = std::chrono::milliseconds(options.min_ms);
+
+        for (int sample = 0; sample < options.samples; sample++){
+            if (prepare){
+                prepare();
+            }
+            long ops = 0;
+            long batch = 1;
+            uint64_t allocations_before = allocation_count();
+            auto start = std::chrono::steady_clock::now();
+            std::chrono::nanoseconds elapsed{0};
+            while (max_ops < 0 || ops < max_ops){
+                if (max_ops >= 0){
+                    batch = std::min(batch, max_ops - ops);
+                }
+                for (long i = 0; i < batch; i++){
+                    op(call++);
+                }
+                ops += batch;
+                elapsed = std::chrono::steady_clock::now() - start;
+                if (elapsed >= min_time){
+                    break;
+                }
+                batch *= 2;
+            }
+            allocations += allocation_count() - allocations_before;
+            if (ops > 0){
+                result.ops += ops;
+                result.sample_ns.push_back(static_cast<double>(elapsed.count()) / ops);
+            }
+        }
+        result.allocs_per_op = result.ops > 0 ? static_cast<double>(allocations) / result.ops : 0;
+        std::cerr << name << " arena " << size << " robots " << robots << ": "
+                  << median(result.sample_ns) << " ns/op\n";
+        results.push_back(result);
+    }
+
+    void run_place_obstacles(int size, std::vector<BenchResult>& results){
+        if (!wanted("place_obstacles")){
+            return;
+        }
+        Arena arena;
+        set_up(arena, size);
+        // Clearing the grid between placements is part of what's timed.
+        measure(results, "place_obstacles", size, 0, [&](long){
+            arena.size_grid();
+            arena.place_obstacles();
+        });
+    }
+
+    void run_size(int size, int count, std::vector<BenchResult>& results){
+        Arena terrain;
+        set_up(terrain, size);
+        terrain.place_obstacles();
+
+        Rng rng(options.seed, 7);
+        cells.resize(4096);
+        for (auto& cell : cells){
+            cell = {rng.below(size), rng.below(size)};
+        }
+        auto cell = [&](long call) -> const std::pair<int, int>& {
+            return cells[call & 4095];
+        };
+
+        // Each arena starts as a copy of the same terrain.
+        Arena arena = terrain;
+        add_robots(arena, count, railgun);
+
+        for (int direction = 0; direction <= 8; direction++){
+            std::string name = "radar_dir" + std::to_string(direction);
+            if (wanted(name)){
+                measure(results, name, size, count, [&](long call){
+                    arena.get_radar_results(call % count, direction, arena.radar_results);
+                });
+            }
+        }
+
+        if (wanted("find_robot_at")){
+            measure(results, "find_robot_at", size, count, [&](long call){
+                const auto& at = cell(call);
+                RobotBase* volatile found = arena.findRobotAt(at.first, at.second);
+                (void)found;
+            });
+        }
+
+        if (wanted("display")){
+            measure(results, "display", size, count, [&](long){
+                arena.display();
+            });
+        }
+
+        // Moves run last: they change where everything is.
+        if (wanted("movement")){
+            measure(results, "movement", size, count, [&](long call){
+                int direction = 1 + call % 8;
+                int distance = 1 + (call / 8) % 3;
+                arena.handle_movement<SilentLog>(call % count, direction, distance);
+            });
+        }
+        arena.cleanup();
+
+        for (int weapon = flamethrower; weapon <= hammer; weapon++){
+            std::string name = std::string("shot_") + weapon_names[weapon];
+            if (!wanted(name)){
+                continue;
+            }
+            // Every sample starts from fresh robots. Grenades run out after 15 throws
+            // each, and empty throws aren't worth timing.
+            Arena shooters;
+            auto prepare = [&](){
+                shooters.cleanup();
+                shooters = terrain;
+                add_robots(shooters, count, static_cast<WeaponType>(weapon));
+            };
+            long max_ops = weapon == grenade ? 15L * count : -1;
+            measure(results, name, size, count, [&](long call){
+                int shooter = call % count;
+                int row = shooters.robot_row[shooter];
+                int col = shooters.robot_col[shooter];
+                int target_row, target_col;
+                if (weapon == grenade){
+                    target_row = cell(call).first;
+                    target_col = cell(call).second;
+                }
+                else{
+                    // Flamethrowers, rails and hammers aim one step off in any direction.
+                    int direction = 1 + call % 8;
+                    target_row = row + directions[direction].first;
+                    target_col = col + directions[direction].second;
+                }
+                shooters.handle_shot<SilentLog>(shooter, target_row, target_col);
+            }, max_ops, prepare);
+            shooters.cleanup();
+        }
+    }
+};
+
+// Plays whole headless games and times them; Arena names it as a friend to have the
+// rounds timed.
+class MatchBench {
+    public:
+    explicit MatchBench(const BenchOptions& options) : options(options){
+        for (const BundledRobot* entry = bundled_robots; entry->name != nullptr; entry++){
+            bundled.push_back(entry->factory);
+        }
+    }
+
+    void run(std::vector<BenchResult>& results){
+        for (int size : options.match_sizes){
+            for (int count : options.match_robots){
+                if (count < 2 || static_cast<long>(count) * 4 > static_cast<long>(size) * size){
+                    continue;
+                }
+                for (const std::string& mix : options.mixes){
+                    if (mix != "bundled" && mix != "stress" && mix != "mixed"){
+                        std::cerr << "Unknown robot mix " << mix << "\n";
+                        continue;
+                    }
+                    if (mix != "stress" && bundled.empty()){
+                        std::cerr << "No bundled robots, skipping the " << mix << " mix\n";
+                        continue;
+                    }
+                    for (int cache_mb : options.radar_cache_mbs){
+                        run_config(size, count, mix, cache_mb, results);
+                    }
+                }
+            }
+        }
+    }
+
+    private:
+    const BenchOptions& options;
+    std::vector<RobotFactory> bundled;
+
+    // The robot for slot i of a mix. Mixed games alternate bundled and stress robots,
+    // and stress robots alternate flamethrowers and grenades.
+    RobotBase* make_robot(const std::string& mix, int i){
+        if (mix == "bundled" || (mix == "mixed" && i % 2 == 0)){
+            int which = mix == "mixed" ? i / 2 : i;
+            return bundled[which % bundled.size()]();
+        }
+        return new StressRobot(i % 4 < 2 ? flamethrower : grenade);
+    }
+
+    // Every sample plays the same matches, seeded seed, seed + 1, ..., so samples only
+    // differ in how long they took. Setting a match up and cleaning it away is timed
+    // along with the game.
+    void run_config(int size, int count, const std::string& mix, int cache_mb, std::vector<BenchResult>& results){
+        // No pits: a robot on one can't move, and Bomber then takes rand() % 0.
+        Arena prototype;
+        prototype.set_headless(true);
+        prototype.set_watch_live(false);
+        prototype.arenaHeight = size;
+        prototype.arenaWidth = size;
+        prototype.mounds = prototype.flamethrowers = size * size / 50;
+        prototype.pits = 0;
+        prototype.maxRound = options.rounds;
+        prototype.maxRobots = 0;
+        prototype.radarCacheMB = cache_mb;
+        prototype.size_grid();
+
+        BenchResult result;
+        result.name = "match_" + mix + (cache_mb > 0 ? "_cache" + std::to_string(cache_mb) : "");
+        result.mix = mix;
+        result.arena = size;
+        result.robots = count;
+        result.round_ns.reserve(static_cast<size_t>(options.samples) * options.matches * options.rounds);
+        uint64_t allocations = 0;
+
+        for (int sample = 0; sample < options.samples; sample++){
+            long rounds = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int match = 0; match < options.matches; match++){
+                Arena arena = prototype;
+                arena.set_seed(options.seed + match);
+                arena.place_obstacles();
+                for (int i = 0; i < count; i++){
+                    RobotBase* robot = make_robot(mix, i);
+                    if (robot != nullptr){
+                        arena.add_robot(robot);
+                    }
+                }
+                arena.round_times = &result.round_ns;
+                MatchResult played = arena.run_game();
+                arena.round_times = nullptr;
+                arena.cleanup();
+                rounds += played.rounds;
+                allocations += played.steady_allocations;
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            result.ops += options.matches;
+            result.rounds = rounds;
+            result.sample_ns.push_back(ns / std::max(1, options.matches));
+            result.sample_rounds_per_sec.push_back(ns > 0 ? rounds * 1e9 / ns : 0);
+        }
+        long total_rounds = result.rounds * options.samples;
+        result.allocs_per_op = total_rounds > 0 ? static_cast<double>(allocations) / total_rounds : 0;
+        std::sort(result.round_ns.begin(), result.round_ns.end());
+        std::cerr << result.name << " arena " << size << " robots " << count << ": "
+                  << 1e9 / std::max(1.0, median(result.sample_ns)) << " matches/s, "
+                  << median(result.sample_rounds_per_sec) << " rounds/s\n";
+        results.push_back(std::move(result));
+    }
+};
+
+static std::vector<int> parse_list(const std::string& text){
+    std::vector<int> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')){
+        if (!item.empty()){
+            values.push_back(std::atoi(item.c_str()));
+        }
+    }
+    return values;
+}
+
+static std::vector<std::string> parse_names(const std::string& text){
+    std::vector<std::string> names;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ',')){
+        if (!item.empty()){
+            names.push_back(item);
+        }
+    }
+    return names;
+}
+
+int main(int argc, char* argv[]){
+    BenchOptions options;
+    std::string save_file;
+    std::string baseline_file;
+    double threshold = 0.10;
+    double alpha = 0.05;
+
+    // A baseline's own options come first, so a compare reruns what it measured;
+    // anything given on the command line still wins.
+    std::vector<BenchResult> baseline;
+    for (int i = 1; i + 1 < argc; i++){
+        if (std::string(argv[i]) == "--compare"){
+            baseline_file = argv[i + 1];
+            std::string error;
+            if (!read_results(baseline_file, options, baseline, error)){
+                std::cerr << "Can't compare: " << error << "\n";
+                return 2;
+            }
+        }
+    }
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if (arg == "--compare" && i + 1 < argc){
+            i++;
+        }
+        else if (arg == "--save" && i + 1 < argc){
+            save_file = argv[++i];
+        }
+        else if (arg == "--threshold" && i + 1 < argc){
+            threshold = std::max(0.0, std::atof(argv[++i]) / 100);
+        }
+        else if (arg == "--alpha" && i + 1 < argc){
+            alpha = std::atof(argv[++i]);
+        }
+        else if (arg == "--suite" && i + 1 < argc){
+            options.suite = argv[++i];
+        }
+        else if (arg == "--sizes" && i + 1 < argc){
+            options.sizes = parse_list(argv[++i]);
+        }
+        else if (arg == "--robots" && i + 1 < argc){
+            options.robot_counts = parse_list(argv[++i]);
+        }
+        else if (arg == "--samples" && i + 1 < argc){
+            options.samples = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--min-ms" && i + 1 < argc){
+            options.min_ms = std::max(0, std::atoi(argv[++i]));
+        }
+        else if (arg == "--only" && i + 1 < argc){
+            options.only = argv[++i];
+        }
+        else if (arg == "--seed" && i + 1 < argc){
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--match-sizes" && i + 1 < argc){
+            options.match_sizes = parse_list(argv[++i]);
+        }
+        else if (arg == "--match-robots" && i + 1 < argc){
+            options.match_robots = parse_list(argv[++i]);
+        }
+        else if (arg == "--mixes" && i + 1 < argc){
+            options.mixes = parse_names(argv[++i]);
+        }
+        else if (arg == "--radar-cache" && i + 1 < argc){
+            options.radar_cache_mbs = parse_list(argv[++i]);
+        }
+        else if (arg == "--matches" && i + 1 < argc){
+            options.matches = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--rounds" && i + 1 < argc){
+            options.rounds = std::max(1, std::atoi(argv[++i]));
+        }
+        else{
+            std::cerr << "Usage: " << argv[0] << " [--suite micro|matches|all] [--samples N] [--seed N]\n"
+                      << "    [--sizes 20,64,...] [--robots 3,30,...] [--min-ms MS] [--only NAME]\n"
+                      << "    [--match-sizes 20,64,...] [--match-robots 6,30,...]"
+                      << " [--mixes bundled,stress,mixed] [--radar-cache 0,64,...]\n"
+                      << "    [--matches N] [--rounds N]\n"
+                      << "    [--save FILE] [--compare FILE] [--threshold PCT] [--alpha P]\n";
+            return 2;
+        }
+    }
+    if (options.suite != "micro" && options.suite != "matches" && options.suite != "all"){
+        std::cerr << "Unknown suite " << options.suite << "\n";
+        return 2;
+    }
+
+    std::vector<BenchResult> results;
+    if (options.suite != "matches"){
+        ArenaBench bench(options);
+        bench.run(results);
+    }
+    if (options.suite != "micro"){
+        MatchBench bench(options);
+        bench.run(results);
+    }
+
+    if (!save_file.empty()){
+        std::ofstream file(save_file);
+        write_results(file, options, results);
+        if (!file){
+            std::cerr << "Could not write " << save_file << "\n";
+            return 2;
+        }
+        std::cerr << "Saved results to " << save_file << "\n";
+    }
+    if (baseline_file.empty()){
+        write_results(std::cout, options, results);
+        return 0;
+    }
+
+    std::cout << "Compared with " << baseline_file << "\n\n";
+    int regressed = compare_results(baseline, results, threshold, alpha, std::cout);
+    return regressed > 0 ? 1 : 0;
+}
@@ -0,0 +1,396 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+#include "Arena.h"
+#include "Rng.h"
+
+// Differential checks for the arena's radar and shot code, built and run by 'make
+// check'. Random arenas are set up and every scan and shot is compared against the
+// plain cell by cell versions the word-parallel scans, the radar cache and the shot
+// stencils replaced. The first difference is printed and the check exits 1.
+//
+//   RobotWarz_check [--trials N] [--seed N]
+
+class CheckRobot : public RobotBase {
+    public:
+    explicit CheckRobot(WeaponType weapon) : RobotBase(3, 2, weapon){
+        m_name = "Check";
+    }
+    void get_radar_direction(int& radar_direction) override{
+        radar_direction = 0;
+    }
+    void process_radar_results(const std::vector<RadarObj>&) override{}
+    bool get_shot_location(int&, int&) override{
+        return false;
+    }
+    void get_move_direction(int& direction, int& distance) override{
+        direction = 0;
+        distance = 0;
+    }
+};
+
+// What one trial's arena looks like. Building it twice from the same spec gives two
+// arenas with the same terrain, robots and damage rolls to come, each with robots of
+// its own.
+struct ArenaSpec {
+    uint64_t seed;
+    int rows;
+    int cols;
+    int mounds;
+    int pits;
+    int flamethrowers;
+    int robots;
+    int radar_cache_mb;
+};
+
+static const char* weapon_names[] = {"flamethrower", "railgun", "grenade", "hammer"};
+
+// Sets arenas up and reaches into their private scan and shot code; Arena names it as
+// a friend.
+class ArenaCheck {
+    public:
+    int failures = 0;
+    long scans = 0;
+    long shots = 0;
+
+    void run_trial(const ArenaSpec& spec){
+        for (int cache_mb : {spec.radar_cache_mb, 0}){
+            ArenaSpec with_cache = spec;
+            with_cache.radar_cache_mb = cache_mb;
+            Arena arena;
+            build(arena, with_cache);
+            check_radar(arena, with_cache);
+            arena.cleanup();
+        }
+        // Shots don't scan, so they don't need a radar cache built.
+        ArenaSpec no_cache = spec;
+        no_cache.radar_cache_mb = 0;
+        for (int weapon = flamethrower; weapon <= hammer; weapon++){
+            check_shots(no_cache, static_cast<WeaponType>(weapon));
+        }
+    }
+
+    private:
+    void build(Arena& arena, const ArenaSpec& spec, WeaponType weapon = railgun){
+        arena.set_seed(spec.seed);
+        arena.set_headless(true);
+        arena.set_watch_live(false);
+        arena.arenaHeight = spec.rows;
+        arena.arenaWidth = spec.cols;
+        arena.mounds = spec.mounds;
+        arena.pits = spec.pits;
+        arena.flamethrowers = spec.flamethrowers;
+        arena.radarCacheMB = spec.radar_cache_mb;
+        arena.maxRound = 1;
+        arena.maxRobots = 0;
+        arena.size_grid();
+        arena.place_obstacles();
+        for (int i = 0; i < spec.robots; i++){
+            arena.add_robot(new CheckRobot(weapon));
+        }
+
+        // Robots are then moved anywhere, terrain and each other included, and some
+        // are destroyed, so scans see stacked, live and dead robots.
+        Rng rng(spec.seed, 11);
+        for (int i = 0; i < spec.robots; i++){
+            if (rng.below(3) == 0){
+                arena.move_robot(i, rng.below(spec.rows), rng.below(spec.cols));
+            }
+            if (rng.below(4) == 0){
+                arena.damage_robot(i, 1000);
+            }
+        }
+    }
+
+    // The robot get_radar_results would report at a cell: the first one in the robot
+    // list standing there, unless that's the robot scanning.
+    static int robot_at(Arena& arena, int row, int col){
+        for (size_t i = 0; i < arena.robots.size(); i++){
+            if (arena.robot_row[i] == row && arena.robot_col[i] == col){
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    static void reference_cell(Arena& arena, int self, int row, int col, std::vector<RadarObj>& results){
+        if (row < 0 || row >= arena.arenaHeight || col < 0 || col >= arena.arenaWidth){
+            return;
+        }
+        char cell = arena.terrain_at(row, col);
+        if (cell == 'M' || cell == 'P' || cell == 'F'){
+            results.push_back(RadarObj(cell, row, col));
+        }
+        int other = robot_at(arena, row, col);
+        if (other >= 0 && other != self){
+            results.push_back(RadarObj(arena.robot_health[other] > 0 ? 'R' : 'X', row, col));
+        }
+    }
+
+    // The radar scan as it was first written: every cell of the 3 wide beam, one at a time.
+    static void reference_radar(Arena& arena, int self, int direction, std::vector<RadarObj>& results){
+        results.clear();
+        int robot_row = arena.robot_row[self];
+        int robot_col = arena.robot_col[self];
+
+        if (direction == 0){
+            for (int dir = 1; dir <= 8; dir++){
+                reference_cell(arena, self, robot_row + directions[dir].first, robot_col + directions[dir].second, results);
+            }
+            return;
+        }
+
+        int delta_row = directions[direction].first;
+        int delta_col = directions[direction].second;
+        int side_row, side_col;
+        if (delta_row == 0){
+            side_row = 1;
+            side_col = 0;
+        }
+        else if (delta_col == 0){
+            side_row = 0;
+            side_col = 1;
+        }
+        else{
+            side_row = -delta_col;
+            side_col = delta_row;
+        }
+
+        int current_row = robot_row + delta_row;
+        int current_col = robot_col + delta_col;
+        while (current_row >= 0 && current_row < arena.arenaHeight && current_col >= 0 && current_col < arena.arenaWidth){
+            for (int offset = -1; offset <= 1; offset++){
+                reference_cell(arena, self, current_row + side_row * offset, current_col + side_col * offset, results);
+            }
+            current_row += delta_row;
+            current_col += delta_col;
+        }
+    }
+
+    static std::string describe(const std::vector<RadarObj>& results){
+        std::string text;
+        char item[48];
+        for (const RadarObj& obj : results){
+            snprintf(item, sizeof(item), " %c(%d,%d)", obj.m_type, obj.m_row, obj.m_col);
+            text += item;
+        }
+        return text.empty() ? " nothing" : text;
+    }
+
+    void fail(const ArenaSpec& spec, const std::string& what){
+        failures++;
+        if (failures <= 5){
+            std::cerr << "Seed " << spec.seed << ", " << spec.rows << "x" << spec.cols << " arena, "
+                      << spec.robots << " robots, radar cache " << spec.radar_cache_mb << " MB: " << what << "\n";
+        }
+    }
+
+    void check_radar(Arena& arena, const ArenaSpec& spec){
+        std::vector<RadarObj> expected;
+        std::vector<RadarObj> found;
+        // Every scan runs twice, so a cache that fills in as it goes is checked both
+        // filling and filled.
+        for (int pass = 0; pass < 2; pass++){
+            for (size_t i = 0; i < arena.robots.size(); i++){
+                for (int direction = 0; direction <= 8; direction++){
+                    reference_radar(arena, i, direction, expected);
+                    arena.get_radar_results(i, direction, found);
+                    scans++;
+                    bool same = expected.size() == found.size();
+                    for (size_t k = 0; same && k < expected.size(); k++){
+                        same = expected[k].m_type == found[k].m_type && expected[k].m_row == found[k].m_row &&
+                               expected[k].m_col == found[k].m_col;
+                    }
+                    if (!same){
+                        fail(spec, "robot " + std::to_string(i) + " scanning direction " + std::to_string(direction) +
+                                   "\n  expected" + describe(expected) + "\n  found   " + describe(found));
+                        return;
+                    }
+                }
+            }
+        }
+    }
+
+    // The shot as it was first written: list every cell the weapon reaches, then hit
+    // the first robot in each that isn't the shooter.
+    static void reference_shot(Arena& arena, int shooter, int shot_row, int shot_col){
+        RobotBase* robot = arena.robots[shooter];
+        int shooter_row = arena.robot_row[shooter];
+        int shooter_col = arena.robot_col[shooter];
+        WeaponType weapon = robot->get_weapon();
+        int delta_row = shot_row > shooter_row ? 1 : shot_row < shooter_row ? -1 : 0;
+        int delta_col = shot_col > shooter_col ? 1 : shot_col < shooter_col ? -1 : 0;
+        auto inside = [&](int row, int col){
+            return row >= 0 && row < arena.arenaHeight && col >= 0 && col < arena.arenaWidth;
+        };
+
+        std::vector<std::pair<int, int>> affected_cells;
+        if (weapon == railgun){
+            // A rail at the shooter's own cell has no direction and goes nowhere.
+            if (delta_row != 0 || delta_col != 0){
+                for (int row = shooter_row + delta_row, col = shooter_col + delta_col; inside(row, col);
+                     row += delta_row, col += delta_col){
+                    affected_cells.push_back({row, col});
+                }
+            }
+        }
+        else if (weapon == flamethrower){
+            int side_row, side_col;
+            if (delta_row == 0){
+                side_row = 1;
+                side_col = 0;
+            }
+            else if (delta_col == 0){
+                side_row = 0;
+                side_col = 1;
+            }
+            else{
+                side_row = -delta_col;
+                side_col = delta_row;
+            }
+            for (int dist = 1; dist <= 4; dist++){
+                for (int offset = -1; offset <= 1; offset++){
+                    int row = shooter_row + delta_row * dist + side_row * offset;
+                    int col = shooter_col + delta_col * dist + side_col * offset;
+                    if (inside(row, col)){
+                        affected_cells.push_back({row, col});
+                    }
+                }
+            }
+        }
+        else if (weapon == hammer){
+            if (inside(shot_row, shot_col) && abs(shot_row - shooter_row) <= 1 && abs(shot_col - shooter_col) <= 1){
+                affected_cells.push_back({shot_row, shot_col});
+            }
+        }
+        else if (weapon == grenade){
+            if (robot->get_grenades() <= 0){
+                return;
+            }
+            uint64_t old_hash = arena.robot_hash(shooter);
+            robot->decrement_grenades();
+            arena.robots_hash ^= old_hash ^ arena.robot_hash(shooter);
+            for (int row = shot_row - 1; row <= shot_row + 1; row++){
+                for (int col = shot_col - 1; col <= shot_col + 1; col++){
+                    if (inside(row, col)){
+                        affected_cells.push_back({row, col});
+                    }
+                }
+            }
+        }
+
+        for (const auto& cell : affected_cells){
+            int target = robot_at(arena, cell.first, cell.second);
+            if (target >= 0 && target != shooter){
+                int damage = arena.calculate_damage(weapon);
+                damage = damage * (100 - arena.robot_armor[target] * 10) / 100;
+                arena.damage_robot(target, damage);
+                arena.damage_dealt[shooter] += damage;
+            }
+        }
+    }
+
+    // Fires the same shots in two copies of an arena, one through handle_shot and one
+    // through reference_shot, and compares every robot afterwards.
+    void check_shots(const ArenaSpec& spec, WeaponType weapon){
+        Arena arena;
+        Arena reference;
+        build(arena, spec, weapon);
+        build(reference, spec, weapon);
+
+        Rng rng(spec.seed, 13);
+        int count = spec.robots * 4;
+        for (int shot = 0; shot < count; shot++){
+            int shooter = rng.below(spec.robots);
+            // Mostly near the shooter, sometimes anywhere, sometimes off the arena.
+            int spread = rng.below(4) == 0 ? std::max(spec.rows, spec.cols) + 2 : 3;
+            int shot_row = arena.robot_row[shooter] + static_cast<int>(rng.below(2 * spread + 1)) - spread;
+            int shot_col = arena.robot_col[shooter] + static_cast<int>(rng.below(2 * spread + 1)) - spread;
+
+            arena.handle_shot<SilentLog>(shooter, shot_row, shot_col);
+            reference_shot(reference, shooter, shot_row, shot_col);
+            shots++;
+
+            for (int i = 0; i < spec.robots; i++){
+                if (arena.robot_health[i] != reference.robot_health[i] || arena.robot_armor[i] != reference.robot_armor[i] ||
+                    arena.robots[i]->get_grenades() != reference.robots[i]->get_grenades() ||
+                    arena.damage_dealt[i] != reference.damage_dealt[i]){
+                    char what[256];
+                    snprintf(what, sizeof(what), "%s shot by robot %d at (%d,%d) left robot %d with health %d "
+                             "armor %d, expected health %d armor %d", weapon_names[weapon], shooter, shot_row,
+                             shot_col, i, arena.robot_health[i], arena.robot_armor[i], reference.robot_health[i],
+                             reference.robot_armor[i]);
+                    fail(spec, what);
+                    arena.cleanup();
+                    reference.cleanup();
+                    return;
+                }
+            }
+            if (arena.state_hash() != reference.state_hash()){
+                fail(spec, std::string(weapon_names[weapon]) + " shot left a different state hash");
+                break;
+            }
+        }
+        arena.cleanup();
+        reference.cleanup();
+    }
+};
+
+int main(int argc, char* argv[]){
+    int trials = 400;
+    uint64_t seed = 1;
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if (arg == "--trials" && i + 1 < argc){
+            trials = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--seed" && i + 1 < argc){
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else{
+            std::cerr << "Usage: " << argv[0] << " [--trials N] [--seed N]\n";
+            return 2;
+        }
+    }
+
+    // Mostly small arenas, which have the most edges per cell, with some wider than a
+    // 64 bit word and a few long thin ones.
+    Rng rng(seed, 17);
+    ArenaCheck check;
+    for (int trial = 0; trial < trials; trial++){
+        ArenaSpec spec;
+        spec.seed = seed + trial;
+        int shape = rng.below(10);
+        if (shape < 6){
+            spec.rows = 1 + rng.below(24);
+            spec.cols = 1 + rng.below(24);
+        }
+        else if (shape < 9){
+            spec.rows = 40 + rng.below(100);
+            spec.cols = 40 + rng.below(100);
+        }
+        else{
+            spec.rows = 1 + rng.below(3);
+            spec.cols = 60 + rng.below(200);
+        }
+        int cells = spec.rows * spec.cols;
+        // Obstacles take up to half the arena, robots up to a quarter of the rest.
+        int obstacles = rng.below(cells / 2 + 1);
+        spec.mounds = rng.below(obstacles + 1);
+        spec.pits = rng.below(obstacles - spec.mounds + 1);
+        spec.flamethrowers = obstacles - spec.mounds - spec.pits;
+        spec.robots = 1 + rng.below(std::max(1, std::min(60, (cells - obstacles) / 4)));
+        spec.radar_cache_mb = 64;
+        check.run_trial(spec);
+    }
+
+    if (check.failures > 0){
+        std::cerr << check.failures << " of " << trials << " trials went wrong\n";
+        return 1;
+    }
+    std::cout << "check: " << trials << " arenas, " << check.scans << " radar scans and " << check.shots
+              << " shots match the cell by cell versions\n";
+    return 0;
+}
@@ -1,24 +1,332 @@
 #include <iostream>
+#include <algorithm>
 #include <vector>
 #include <cstdlib>
 #include <ctime>
 #include <fstream>
 #include <string>
 #include <iomanip>
+#include <thread>
+#include <unistd.h>
+#include <memory>
+#include <sstream>
+#include <chrono>
+#include <cmath>
 #include "Arena.h"
+#include "Tournament.h"
 #include "RobotBase.h"
+#include "Replay.h"
 
-int main(){
-    srand(static_cast<unsigned>(time(nullptr)));
+// Shows the board at the start of a replay round; rounds() + 1 is the end of the game.
+static void show_replay_round(Arena& arena, const ReplayReader& reader, int round, bool clear){
+    ReplayState state;
+    reader.seek(round, state);
+    arena.show_replay_state(state);
+
+    if (clear){
+        std::cout << "\x1b[H\x1b[2J";
+    }
+    if (round > reader.rounds()){
+        std::cout << "=========== end of game after round " << reader.rounds() << " ===========\n";
+    }
+    else{
+        std::cout << "=========== round " << round << " of " << reader.rounds() << " ===========\n";
+    }
+    arena.display();
+    for (const ReplayRobot& robot : state.robots){
+        std::cout << robot.name << " (" << robot.character << "):  H: " << robot.health << "  A: " << robot.armor
+                  << "  at: (" << robot.row << "," << robot.col << ")" << (robot.health <= 0 ? "  destroyed" : "") << "\n";
+    }
+}
+
+// Shows rounds one after another at speed rounds a second, until the end of the game,
+// or the start of it when speed is negative. 0 doesn't wait between rounds at all.
+// Returns the round it stopped on.
+static int play_replay_rounds(Arena& arena, const ReplayReader& reader, int round, double speed, bool clear){
+    int step = speed < 0 ? -1 : 1;
+    auto pause = speed == 0 ? std::chrono::steady_clock::duration::zero() :
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / std::fabs(speed)));
+    auto next = std::chrono::steady_clock::now();
+    while (true){
+        show_replay_round(arena, reader, round, clear);
+        if ((step > 0 && round > reader.rounds()) || (step < 0 && round <= 1)){
+            return round;
+        }
+        next += pause;
+        std::this_thread::sleep_until(next);
+        round += step;
+    }
+}
+
+// Plays a recorded game back without loading any robot code. Unless a speed is given,
+// a terminal gets a prompt for stepping, seeking and playing.
+static int play_replay(const std::string& fileName, int round, double speed, bool interactive){
+    ReplayReader reader;
+    if (!reader.open(fileName)){
+        std::cout << "Could not read replay: " << reader.error() << "\n";
+        return 1;
+    }
+    std::cout << "Replay of seed " << reader.seed() << ", " << reader.rounds() << " rounds\n";
+
+    Arena arena;
+    arena.load_replay(reader);
+    int last = reader.rounds() + 1;
+    round = std::clamp(round, 1, last);
+    bool clear = isatty(STDOUT_FILENO);
+
+    if (!interactive){
+        play_replay_rounds(arena, reader, round, speed, clear);
+        arena.cleanup();
+        return 0;
+    }
+
+    const char* help = "Enter or n: next round, b: back a round, g N: go to round N, "
+                       "p [SPEED]: play at SPEED rounds a second (negative plays backward), q: quit\n";
+    show_replay_round(arena, reader, round, clear);
+    std::cout << help;
+    std::string line;
+    while (std::cout << "> " << std::flush, std::getline(std::cin, line)){
+        std::istringstream words(line);
+        std::string command;
+        words >> command;
+        if (command.empty() || command == "n"){
+            round = std::min(round + 1, last);
+        }
+        else if (command == "b"){
+            round = std::max(round - 1, 1);
+        }
+        else if (command == "g"){
+            int target = round;
+            words >> target;
+            round = std::clamp(target, 1, last);
+        }
+        else if (command == "p"){
+            double play_speed = 1;
+            words >> play_speed;
+            round = play_replay_rounds(arena, reader, round, play_speed, clear);
+            continue;
+        }
+        else if (command == "q"){
+            break;
+        }
+        else{
+            std::cout << help;
+            continue;
+        }
+        show_replay_round(arena, reader, round, clear);
+    }
+    arena.cleanup();
+    return 0;
+}
+
+// Reruns a recorded game from its seed, headless, and compares the state hash at the
+// start of every round with the recording. Reports the first round that differs. The
+// arena is set up as recorded rather than from config.txt, and the robots loaded have
+// to be the recorded ones, in the same order, or there is nothing to compare.
+static int verify_replay(const std::string& fileName){
+    ReplayReader reader;
+    if (!reader.open(fileName)){
+        std::cout << "Could not read replay: " << reader.error() << "\n";
+        return 1;
+    }
+    std::cout << "Verifying seed " << reader.seed() << ", " << reader.rounds() << " rounds\n";
 
     Arena arena;
+    arena.set_seed(reader.seed());
     arena.load_config("config.txt");
+    arena.use_replay_settings(reader);
+    arena.set_headless(true);
     arena.place_obstacles();
     arena.load_all_robots();
-    arena.display();
-    arena.run_game();
+
+    std::vector<std::string> loaded = arena.robot_names();
+    bool same_robots = loaded.size() == reader.robots().size();
+    for (size_t i = 0; same_robots && i < loaded.size(); i++){
+        same_robots = loaded[i] == reader.robots()[i].name;
+    }
+    if (!same_robots){
+        std::cout << "Can't verify: the recording's robots are";
+        for (const ReplayRobot& robot : reader.robots()){
+            std::cout << " " << robot.name;
+        }
+        std::cout << ", but the robots loaded are";
+        for (const std::string& name : loaded){
+            std::cout << " " << name;
+        }
+        std::cout << "\n";
+        arena.cleanup();
+        return 1;
+    }
+    MatchResult result = arena.run_game();
     arena.cleanup();
 
-    return 0;
+    int rounds = result.round_hashes.size();
+    int diverged = 0;
+    for (int round = 1; round <= std::min(rounds, reader.rounds()) && diverged == 0; round++){
+        if (result.round_hashes[round - 1] != reader.round_hash(round)){
+            diverged = round;
+        }
+    }
+    if (diverged == 0 && rounds != reader.rounds()){
+        diverged = std::min(rounds, reader.rounds()) + 1;
+    }
+    if (diverged == 0 && result.final_hash != reader.round_hash(reader.rounds() + 1)){
+        diverged = rounds + 1;
+    }
+
+    if (diverged == 0){
+        std::cout << "OK: all " << rounds << " rounds match\n";
+        return 0;
+    }
+    std::cout << "Diverged at ";
+    if (diverged > std::min(rounds, reader.rounds())){
+        std::cout << "the end: recorded game ran " << reader.rounds() << " rounds, rerun " << rounds << "\n";
+        std::cout << "stalemate_rounds and end_on_repeat aren't recorded; check config.txt has the recorded game's\n";
+    }
+    else{
+        std::cout << "round " << diverged << std::hex << ": recorded state hash " << reader.round_hash(diverged)
+                  << ", rerun " << result.round_hashes[diverged - 1] << std::dec << "\n";
+    }
+    return 1;
 }
 
+int main(int argc, char* argv[]){
+    uint64_t seed = static_cast<uint64_t>(time(nullptr));
+    int tournament_matches = 0;
+    int jobs = std::max(1u, std::thread::hardware_concurrency());
+    bool headless = false;
+    bool async_log = false;
+    std::string record_file;
+    std::string replay_file;
+    std::string verify_file;
+    int replay_round = 1;
+    double replay_speed = 0;
+    bool replay_speed_set = false;
+    LogSink::Overflow log_overflow = LogSink::overflow_block;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if (arg == "--seed" && i + 1 < argc){
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--tournament" && i + 1 < argc){
+            tournament_matches = std::atoi(argv[++i]);
+        }
+        else if (arg == "--jobs" && i + 1 < argc){
+            jobs = std::atoi(argv[++i]);
+        }
+        else if (arg == "--headless"){
+            headless = true;
+        }
+        else if (arg == "--record" && i + 1 < argc){
+            record_file = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc){
+            replay_file = argv[++i];
+        }
+        else if (arg == "--verify" && i + 1 < argc){
+            verify_file = argv[++i];
+        }
+        else if (arg == "--round" && i + 1 < argc){
+            replay_round = std::atoi(argv[++i]);
+        }
+        else if (arg == "--speed" && i + 1 < argc){
+            replay_speed = std::strtod(argv[++i], nullptr);
+            replay_speed_set = true;
+        }
+        else if (arg == "--async-log" && i + 1 < argc && (std::string(argv[i + 1]) == "block" || std::string(argv[i + 1]) == "drop")){
+            async_log = true;
+            log_overflow = std::string(argv[++i]) == "drop" ? LogSink::overflow_drop : LogSink::overflow_block;
+        }
+        else{
+            std::cout << "Usage: " << argv[0] << " [--seed N] [--headless] [--record FILE] [--async-log block|drop] [--tournament MATCHES [--jobs N]]\n"
+                      << "       " << argv[0] << " --replay FILE [--round N] [--speed ROUNDS_PER_SECOND]\n"
+                      << "       " << argv[0] << " --verify FILE\n";
+            return 1;
+        }
+    }
+
+    if (!replay_file.empty()){
+        return play_replay(replay_file, replay_round, replay_speed, !replay_speed_set && isatty(STDIN_FILENO));
+    }
+    if (!verify_file.empty()){
+        return verify_replay(verify_file);
+    }
+
+    std::cout << "Seed: " << seed << "\n";
+
+    if (tournament_matches > 0){
+        // Match n is played with seed + n, so any single match can be rerun on its own.
+        Arena loader;
+        loader.load_config("config.txt");
+        std::vector<RobotFactory> factories = loader.load_robot_factories();
+
+        Tournament tournament("config.txt", tournament_matches, jobs, seed);
+        tournament.run(factories);
+        tournament.report(std::cout);
+
+        loader.cleanup();
+        return 0;
+    }
+
+    Arena arena;
+    arena.set_seed(seed);
+    arena.load_config("config.txt");
+    arena.set_headless(headless);
+    arena.place_obstacles();
+    arena.load_all_robots();
+
+    // Watching live on a terminal redraws the board in place instead of scrolling it.
+    bool live_view = arena.is_watch_live() && !headless && !async_log && isatty(STDOUT_FILENO);
+    if (live_view){
+        arena.set_live_view(true);
+    }
+    else if (!headless){
+        arena.display();
+    }
+    // The replay is written when the game ends.
+    std::unique_ptr<ReplayWriter> replay;
+    if (!record_file.empty()){
+        replay = std::make_unique<ReplayWriter>(record_file);
+        if (!replay->ok()){
+            std::cout << "Could not write replay to " << record_file << "\n";
+            return 1;
+        }
+        arena.set_replay(replay.get());
+    }
+
+    // With an async log the game only queues its output; a background thread writes it.
+    MatchResult result;
+    if (async_log){
+        LogSink sink(std::cout, log_overflow);
+        arena.set_log_sink(&sink);
+        result = arena.run_game();
+        arena.set_log_sink(nullptr);
+        if (sink.dropped() > 0){
+            std::cout << "Log records dropped: " << sink.dropped() << "\n";
+        }
+    }
+    else{
+        result = arena.run_game();
+    }
+    arena.cleanup();
+#ifdef ROBOTWARZ_COUNT_ALLOCS
+    // Every way of playing is checked: headless, printed, or through the async log.
+    std::cout << "Arena allocations after round 1: " << result.steady_allocations << "\n";
+#endif
+
+    // Headless games print nothing while playing, so summarize the result instead.
+    if (headless){
+        std::cout << "Rounds: " << result.rounds << (result.stalemate ? " (stalemate)" : "") << "\n";
+        std::cout << "Winner: " << (result.winner >= 0 ? result.robots[result.winner].name : "none") << "\n";
+        std::cout << "State hash: " << std::hex << result.final_hash << std::dec << "\n";
+        std::cout << std::left << std::setw(16) << "Robot" << std::right << std::setw(8) << "Health"
+                  << std::setw(10) << "Survived" << std::setw(8) << "Damage" << "\n";
+        for (const RobotResult& robot : result.robots){
+            std::cout << std::left << std::setw(16) << robot.name << std::right << std::setw(8) << robot.health
+                      << std::setw(10) << robot.rounds_survived << std::setw(8) << robot.damage_dealt << "\n";
+        }
+    }
+
+    return 0;
+}